@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+
+"""
+Generates soda/xid.cc, the tables behind is_xid_start() and
+is_xid_continue(), from the Unicode database Python was built with.
+Python's own identifiers are XID_Start followed by XID_Continue, so
+str.isidentifier() gives the properties.
+"""
+
+import os
+import unicodedata
+
+BLOCK = 256
+
+def properties():
+	start = []
+	cont = []
+	for cp in range(0x110000):
+		if 0xD800 <= cp < 0xE000:
+			start.append(False)
+			cont.append(False)
+			continue
+		ch = chr(cp)
+		start.append(ch != '_' and ch.isidentifier())
+		cont.append(('a' + ch).isidentifier())
+	return start, cont
+
+def words(bits):
+	return [sum(1 << i for i in range(32) if bits[w * 32 + i])
+	        for w in range(BLOCK // 32)]
+
+def generate(out):
+	start, cont = properties()
+	last = max(cp for cp in range(0x110000) if cont[cp])
+	num_blocks = last // BLOCK + 1
+	index = []
+	blocks = []
+	seen = {}
+	for b in range(num_blocks):
+		lo = b * BLOCK
+		key = (tuple(words(start[lo:lo + BLOCK])),
+		       tuple(words(cont[lo:lo + BLOCK])))
+		if key not in seen:
+			seen[key] = len(blocks)
+			blocks.append(key)
+		index.append(seen[key])
+	assert len(blocks) <= 256
+
+	w = out.write
+	w('// Generated by scripts/genxid.py from Unicode %s, do not edit\n'
+	  % unicodedata.unidata_version)
+	w('#include <soda/sodainc.h> // pch\n')
+	w('#include <soda/xid.h>\n\n')
+	w('namespace Soda\n{\n\n')
+	w('const uint8_t xid_index[XID_BLOCKS] = {\n')
+	for i in range(0, len(index), 16):
+		w('\t' + ', '.join('%d' % n for n in index[i:i + 16]) + ',\n')
+	w('};\n\n')
+	w('const uint32_t xid_bits[][2][XID_BLOCK / 32] = {\n')
+	for s, c in blocks:
+		w('\t{ { ' + ', '.join('0x%08X' % n for n in s[:4]) + ',\n')
+		w('\t    ' + ', '.join('0x%08X' % n for n in s[4:]) + ' },\n')
+		w('\t  { ' + ', '.join('0x%08X' % n for n in c[:4]) + ',\n')
+		w('\t    ' + ', '.join('0x%08X' % n for n in c[4:]) + ' } },\n')
+	w('};\n\n')
+	w('} // namespace Soda\n')
+	return num_blocks
+
+if __name__ == "__main__":
+	base_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+	with open(os.path.join(base_dir, "soda", "xid.cc"), "w") as f:
+		print("XID_BLOCKS = %d" % generate(f))
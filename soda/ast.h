@@ -2,6 +2,8 @@
 #define SODA_AST_H
 
 #include <soda/astvisitor.h>
+#include <soda/interner.h>
+#include <soda/sourcemanager.h>
 #include <soda/token.h>
 #include <soda/sourcelocation.h>
 #include <string>
@@ -48,12 +50,9 @@ struct Node : public AstVisitable
 	SourceLocation location;
 	Node() {}
 	Node(SourceLocation& location) : location(location) {}
-	Node(const SourcePosition& start_pos, const SourcePosition& end_pos,
-	     Node *parent=nullptr)
-		: parent(parent), location(start_pos, end_pos) {}
+	Node(size_t start_offset, size_t end_offset, Node *parent=nullptr)
+		: parent(parent), location(start_offset, end_offset) {}
 	virtual ~Node() {}
-	size_t line() const { return location.line.start; }
-	size_t column() const { return location.column.start; }
 };
 
 struct Stmt;
@@ -81,7 +80,7 @@ struct Stmt : public Node
 typedef std::unique_ptr<Stmt> StmtPtr;
 typedef std::vector<StmtPtr> StmtList;
 
-typedef std::unordered_map<std::u32string, Stmt*> SymbolTable;
+typedef std::unordered_map<Symbol, Stmt*> SymbolTable;
 
 struct Block : public Stmt
 {
@@ -245,9 +244,8 @@ struct ExprStmt : public Stmt
 
 struct Float : public Expr
 {
-	long double value;
-	Float(std::u32string valstr, const SourcePosition& spos,
-		const SourcePosition& end);
+	double value;
+	Float(double value, size_t spos, size_t end);
 	SODA_NODE_VISITABLE
 };
 
@@ -298,10 +296,10 @@ struct FuncDef : public Stmt
 
 struct Ident : public Expr
 {
-	std::u32string name;
+	Symbol name; // in the TU's interner
 	Stmt *decl;
 	template< typename... Args >
-	Ident(std::u32string name, Args... args)
+	Ident(Symbol name, Args... args)
 		: Expr(args...), name(name), decl(nullptr) {}
 	SODA_NODE_VISITABLE
 };
@@ -331,8 +329,7 @@ struct Import : public Stmt
 struct Integer : public Expr
 {
 	unsigned long long value;
-	Integer(std::u32string valstr, int base, const SourcePosition& spos,
-		const SourcePosition& end);
+	Integer(unsigned long long value, size_t spos, size_t end);
 	SODA_NODE_VISITABLE
 };
 
@@ -360,10 +357,10 @@ struct ReturnStmt : public Stmt
 
 struct StrLit : public Expr
 {
-	std::u32string text;
+	Symbol value; // in TU::literals, escapes decoded
 	template< typename... Args >
-	StrLit(std::u32string text, Args... args)
-		: Expr(args...), text(text) {}
+	StrLit(Symbol value, Args... args)
+		: Expr(args...), value(value) {}
 	SODA_NODE_VISITABLE
 };
 
@@ -380,11 +377,11 @@ struct SwitchStmt : public Stmt
 
 struct TypeIdent : public Stmt
 {
-	std::u32string name;
+	Symbol name; // in the TU's interner
 	bool is_const;
 	Stmt* decl;
 	template< typename... Args >
-	TypeIdent(std::u32string name, bool is_const, Args... args)
+	TypeIdent(Symbol name, bool is_const, Args... args)
 		: Stmt(args...), name(name), is_const(is_const), decl(nullptr) {}
 	SODA_NODE_VISITABLE
 };
@@ -394,6 +391,9 @@ struct TU : public Stmt
 	StmtList stmts;
 	SymbolTable symbols;
 	std::string fn;
+	SourceManager sources; // fn and anything it pulls in, filled in by parse()
+	Interner interner;     // names of every Ident and TypeIdent
+	Interner literals;     // values of every StrLit, each distinct one once
 	template< typename... Args >
 	TU(std::string fn, Args... args) : Stmt(args...), fn(fn) {}
 	SODA_NODE_VISITABLE
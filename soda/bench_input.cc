@@ -0,0 +1,135 @@
+#include <soda/sodainc.h> // pch
+#include <soda/input.h>
+#include <soda/lexer.h>
+#include <soda/sourcebuffer.h>
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utf8/utf8.h>
+
+using namespace Soda;
+
+// Mostly-ASCII Soda source with the odd multibyte character, similar to
+// what code generators produce.
+static const char snippet[] =
+	u8"// generated accessors for the message table\n"
+	u8"namespace gen\n"
+	u8"{\n"
+	u8"\tclass Message : base.Object\n"
+	u8"\t{\n"
+	u8"\t\tpublic static int count = 0x7fff + 0b1010 * 12.5;\n"
+	u8"\t\tprivate int lookup(int key, float scale = 1.5)\n"
+	u8"\t\t{\n"
+	u8"\t\t\t/* caf\u00E9 \u2014 na\u00EFve */\n"
+	u8"\t\t\tif (key >= 10) { return table.get(key) << 2; }\n"
+	u8"\t\t\treturn key;\n"
+	u8"\t\t}\n"
+	u8"\t}\n"
+	u8"}\n";
+
+static std::string make_corpus(size_t size)
+{
+	std::string corpus;
+	corpus.reserve(size + sizeof(snippet));
+	while (corpus.size() < size)
+		corpus += snippet;
+	return corpus;
+}
+
+// The same text in the legacy encodings Input transcodes from, characters
+// Latin-1 can't represent become '?'
+static std::string to_utf16le(const std::string& utf8)
+{
+	std::u16string units;
+	utf8::utf8to16(utf8.begin(), utf8.end(), std::back_inserter(units));
+	std::string bytes("\xFF\xFE");
+	for (char16_t u : units)
+	{
+		bytes += static_cast<char>(u & 0xFF);
+		bytes += static_cast<char>(u >> 8);
+	}
+	return bytes;
+}
+
+static std::string to_latin1(const std::string& utf8)
+{
+	std::string bytes;
+	for (auto it = utf8.begin(); it != utf8.end(); )
+	{
+		uint32_t cp = utf8::next(it, utf8.end());
+		bytes += (cp < 0x100) ? static_cast<char>(cp) : '?';
+	}
+	return bytes;
+}
+
+template< typename Func >
+static void run(const char *name, size_t bytes, Func func)
+{
+	const int rounds = 5;
+	double best = 0.0;
+	for (int i = 0; i < rounds; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		func();
+		std::chrono::duration<double> secs =
+			std::chrono::steady_clock::now() - start;
+		double mbs = (bytes / (1024.0 * 1024.0)) / secs.count();
+		if (mbs > best)
+			best = mbs;
+	}
+	std::cout << name << ": " << best << " MB/s\n";
+}
+
+int main(int argc, char *argv[])
+{
+	std::string corpus;
+	if (argc > 1)
+	{
+		SourceBuffer buf(argv[1]);
+		if (!buf.is_open())
+		{
+			std::cerr << "error: failed to open '" << argv[1] << "'\n";
+			return 1;
+		}
+		corpus.assign(buf.begin(), buf.size());
+	}
+	else
+		corpus = make_corpus(32 * 1024 * 1024);
+
+	const char *begin = corpus.data();
+	const char *end = begin + corpus.size();
+	size_t sink = 0;
+
+	run("input", corpus.size(), [&]() {
+		LineTable lines;
+		Input input(begin, end, &lines);
+		while (input.next() != Input::END)
+			sink++;
+	});
+
+	// rates for the legacy encodings are in terms of the UTF-8 size so
+	// they compare directly with the above
+	std::string utf16 = to_utf16le(corpus);
+	run("input (utf-16)", corpus.size(), [&]() {
+		LineTable lines;
+		Input input(utf16.data(), utf16.data() + utf16.size(), &lines);
+		while (input.next() != Input::END)
+			sink++;
+	});
+
+	std::string latin1 = to_latin1(corpus);
+	run("input (latin-1)", corpus.size(), [&]() {
+		LineTable lines;
+		Input input(latin1.data(), latin1.data() + latin1.size(), &lines);
+		while (input.next() != Input::END)
+			sink++;
+	});
+
+	run("tokenize", corpus.size(), [&]() {
+		LineTable lines;
+		sink += tokenize(begin, end, &lines).size();
+	});
+
+	return (sink == 0);
+}
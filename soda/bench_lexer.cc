@@ -0,0 +1,215 @@
+#include <soda/sodainc.h> // pch
+#include <soda/highlighter.h>
+#include <soda/keywords.h>
+#include <soda/lexer.h>
+#include <soda/parallellexer.h>
+#include <soda/relexer.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Soda;
+
+// Identifier-heavy Soda source: declarations, calls and member accesses
+// with a keyword every few words.
+static const char snippet[] =
+	"public class RecordWriter : base.StreamWriter\n"
+	"{\n"
+	"\tprivate static const int default_capacity = 64;\n"
+	"\tpublic fun write_record(Record record, Options options) : bool\n"
+	"\t{\n"
+	"\t\tvar header_length = record.header.length + options.padding;\n"
+	"\t\tif (header_length > buffer.capacity) { buffer.grow(header_length); }\n"
+	"\t\telif (record.kind == RecordKind.empty) { return false; }\n"
+	"\t\telse { buffer.append(record.header, header_length); }\n"
+	"\t\tswitch (record.kind) { case RecordKind.inline: break; default: break; }\n"
+	"\t\treturn stream.flush(buffer, options.sync_mode);\n"
+	"\t}\n"
+	"}\n";
+
+// Expression-heavy code, mostly operators and punctuation
+static const char op_snippet[] =
+	"x=(a+b)*c-d/e%f;y<<=z>>2;if(p!=q&&r>=s||t<=u){v+=w;w-=v;}\n"
+	"m[i++]=n[--j]->k;flags|=MASK^bits&~other;ok=!done?a==b:c;\n";
+
+// A license header and long literals, mostly scanned for their terminator
+static const char lit_snippet[] =
+	"/*\n"
+	" * Licensed under the Apache License, Version 2.0 (the \"License\");\n"
+	" * you may not use this file except in compliance with the License.\n"
+	" * Unless required by applicable law or agreed to in writing, software\n"
+	" * distributed under the License is distributed on an \"AS IS\" BASIS.\n"
+	" */\n"
+	"string usage = \"usage: soda [options] file...\\n  -o <file>  write "
+	"the output to <file>\\n  -v  print the version and exit\";\n"
+	"char quote = '\\'';\n";
+
+// The if/else chain keyword_kind() replaced, kept as a baseline
+static Token::Kind keyword_chain(const std::u32string& text)
+{
+	if (text == U"if") return Token::IF;
+	else if (text == U"elif") return Token::ELIF;
+	else if (text == U"else") return Token::ELSE;
+	else if (text == U"fun") return Token::FUN;
+	else if (text == U"var") return Token::VAR;
+	else if (text == U"struct") return Token::STRUCT;
+	else if (text == U"enum") return Token::ENUM;
+	else if (text == U"union") return Token::UNION;
+	else if (text == U"alias") return Token::ALIAS;
+	else if (text == U"return") return Token::RETURN;
+	else if (text == U"import") return Token::IMPORT;
+	else if (text == U"from") return Token::FROM;
+	else if (text == U"class") return Token::CLASS;
+	else if (text == U"switch") return Token::SWITCH;
+	else if (text == U"case") return Token::CASE;
+	else if (text == U"default") return Token::DEFAULT;
+	else if (text == U"break") return Token::BREAK;
+	else if (text == U"const") return Token::CONST;
+	else if (text == U"static") return Token::STATIC;
+	else if (text == U"public") return Token::PUBLIC;
+	else if (text == U"private") return Token::PRIVATE;
+	else if (text == U"protected") return Token::PROTECTED;
+	else if (text == U"internal") return Token::INTERNAL;
+	else if (text == U"namespace") return Token::NAMESPACE;
+	else if (text == U"delegate") return Token::DELEGATE;
+	else if (text == U"CCode") return Token::CCODE;
+	return Token::IDENT;
+}
+
+template< typename Func >
+static double best_seconds(Func func)
+{
+	const int rounds = 5;
+	double best = 0.0;
+	for (int i = 0; i < rounds; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		func();
+		std::chrono::duration<double> secs =
+			std::chrono::steady_clock::now() - start;
+		if (i == 0 || secs.count() < best)
+			best = secs.count();
+	}
+	return best;
+}
+
+static void report_rate(const char *name, double count, const char *unit,
+                        double secs)
+{
+	std::cout << name << ": " << count / secs / 1e6 << " M" << unit << "/s\n";
+}
+
+int main()
+{
+	std::string corpus;
+	while (corpus.size() < 16 * 1024 * 1024)
+		corpus += snippet;
+	const char *begin = corpus.data();
+	const char *end = begin + corpus.size();
+	size_t sink = 0;
+
+	std::vector<std::u32string> words;
+	std::vector<uint32_t> hashes;
+	Lexer lex(begin, begin + sizeof(snippet) - 1);
+	while (lex.next() != Token::END)
+	{
+		std::u32string word(lex.text(lex.token));
+		if (lex.token.kind != Token::IDENT &&
+		    keyword_kind(word) == Token::IDENT)
+			continue;
+		uint32_t hash = KEYWORD_HASH_INIT;
+		for (char32_t ch : word)
+			hash = keyword_hash_next(hash, ch);
+		words.push_back(word);
+		hashes.push_back(hash);
+	}
+	const size_t reps = 200000;
+	double lookups = double(words.size()) * reps;
+
+	report_rate("keywords (if/else chain)", lookups, "lookups",
+		best_seconds([&]() {
+			for (size_t r = 0; r < reps; r++)
+				for (const std::u32string& w : words)
+					sink += keyword_chain(w);
+		}));
+
+	// the hash is normally a by-product of scanning the identifier
+	report_rate("keywords (perfect hash)", lookups, "lookups",
+		best_seconds([&]() {
+			for (size_t r = 0; r < reps; r++)
+				for (size_t i = 0; i < words.size(); i++)
+					sink += keyword_kind(words[i].data(), words[i].size(),
+					                     hashes[i]);
+		}));
+
+	report_rate("tokenize", corpus.size(), "B",
+		best_seconds([&]() {
+			LineTable lines;
+			sink += tokenize(begin, end, &lines).size();
+		}));
+
+	unsigned cores = std::max(4u, std::thread::hardware_concurrency());
+	for (unsigned threads = 2; threads <= cores; threads *= 2)
+	{
+		std::string name = "tokenize (" + std::to_string(threads) + " threads)";
+		report_rate(name.c_str(), corpus.size(), "B",
+			best_seconds([&]() {
+				LineTable lines;
+				sink += tokenize_parallel(begin, end, &lines, threads).size();
+			}));
+	}
+
+	// typing a character into the middle of the corpus and deleting it
+	TokenList edited = tokenize(begin, end);
+	std::string typed(corpus);
+	const size_t edits = 200;
+	double secs = best_seconds([&]() {
+		for (size_t i = 0; i < edits; i += 2)
+		{
+			size_t at = typed.size() / 2 + i;
+			typed.insert(at, 1, 'x');
+			sink += relex(edited, &typed[0], &typed[0] + typed.size(),
+			              TextEdit(at, 0, 1)).inserted;
+			typed.erase(at, 1);
+			sink += relex(edited, &typed[0], &typed[0] + typed.size(),
+			              TextEdit(at, 1, 0)).inserted;
+		}
+	});
+	std::cout << "relex: " << edits / secs << " edits/s\n";
+
+	// highlighting a screenful (about 60 lines) at places all over the file
+	const size_t views = 1000, view_size = 4096;
+	std::vector<HighlightSpan> spans(view_size);
+	secs = best_seconds([&]() {
+		for (size_t i = 0; i < views; i++)
+		{
+			size_t at = (corpus.size() - view_size) / views * i;
+			sink += highlight(begin, end, highlight_start(edited, at),
+			                  at + view_size, spans.data(), spans.size());
+		}
+	});
+	std::cout << "highlight: " << secs / views * 1e6 << " us/viewport\n";
+
+	std::string ops;
+	while (ops.size() < 16 * 1024 * 1024)
+		ops += op_snippet;
+	report_rate("tokenize (operators)", ops.size(), "B",
+		best_seconds([&]() {
+			LineTable lines;
+			sink += tokenize(ops.data(), ops.data() + ops.size(), &lines).size();
+		}));
+
+	std::string lits;
+	while (lits.size() < 16 * 1024 * 1024)
+		lits += lit_snippet;
+	report_rate("tokenize (strings and comments)", lits.size(), "B",
+		best_seconds([&]() {
+			LineTable lines;
+			sink += tokenize(lits.data(), lits.data() + lits.size(),
+			                 &lines).size();
+		}));
+
+	return (sink == 0);
+}
@@ -0,0 +1,41 @@
+#ifndef SODA_CPUDISPATCH_H
+#define SODA_CPUDISPATCH_H
+
+// Choosing between the AVX2, SSE2 and portable versions of a vectorized
+// function once, at startup. SELECT(name) picks among name_avx2,
+// name_sse2 and name_scalar, and SELECT(name, <args>) among the same
+// templates instantiated with args.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define SODA_X86 1
+# include <immintrin.h>
+#else
+# define SODA_X86 0
+#endif
+
+namespace Soda
+{
+
+#if SODA_X86
+// Pick the widest implementation the CPU supports
+template<typename Func>
+Func pick_for_cpu(Func avx2, Func sse2, Func scalar)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return avx2;
+	if (__builtin_cpu_supports("sse2"))
+		return sse2;
+	return scalar;
+}
+# define SELECT(name, ...)                                     \
+	::Soda::pick_for_cpu(name##_avx2 __VA_ARGS__,              \
+	                     name##_sse2 __VA_ARGS__,              \
+	                     name##_scalar __VA_ARGS__)
+#else
+# define SELECT(name, ...) name##_scalar __VA_ARGS__
+#endif
+
+} // namespace Soda
+
+#endif // SODA_CPUDISPATCH_H
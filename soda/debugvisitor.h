@@ -2,6 +2,7 @@
 #define SODA_DEBUG_VISITOR_H
 
 #include <soda/ast.h>
+#include <soda/utils.h>
 #include <ostream>
 #include <sstream>
 
@@ -13,6 +14,9 @@ class DebugVisitor : public AstVisitor
 public:
 	DebugVisitor(std::ostream& stream, int indent_width=2)
 		: s(stream),
+		  sources(nullptr),
+		  interner(nullptr),
+		  literals(nullptr),
 		  indent_level(0),
 		  indent_width(indent_width),
 		  indent_str(indent_width, ' ')
@@ -21,6 +25,9 @@ public:
 
 private:
 	std::ostream& s;
+	const SourceManager *sources; // from the TU being dumped
+	const Interner *interner;     // ditto
+	const Interner *literals;     // ditto
 	int indent_level, indent_width;
 	std::string indent_str;
 
@@ -35,13 +42,23 @@ private:
 	std::string pos(Node& node)
 	{
 		std::stringstream ss;
-		// FIXME: don't munge the numbers here, fix the Input class to
-		// store them properly
-		ss << "(" << (node.line() + 1) << ","
-		           << node.column() - 1 << ")";
+		if (sources)
+		{
+			SourcePosition p = sources->position(node.location.start());
+			ss << "(" << (p.line + 1) << "," << p.column << ")";
+		}
+		else
+			ss << "(@" << node.location.start() << ")";
 		return ss.str();
 	}
 
+	std::string name(Symbol sym)
+	{
+		if (interner)
+			return utf8_encode(interner->text(sym));
+		return "#" + std::to_string(sym);
+	}
+
 	bool visit(Alias& node)
 	{
 		s << indent() << "(alias " << pos(node) << "\n";
@@ -350,7 +367,7 @@ private:
 
 	bool visit(Ident& node)
 	{
-		s << indent() << "(ident " << pos(node) << " '" << node.name << "')";
+		s << indent() << "(ident " << pos(node) << " '" << name(node.name) << "')";
 		return true;
 	}
 
@@ -429,7 +446,12 @@ private:
 
 	bool visit(StrLit& node)
 	{
-		s << indent() << "(strlit " << pos(node) << " '" << node.text << "')";
+		s << indent() << "(strlit " << pos(node) << " '";
+		if (literals)
+			s << utf8_encode(literals->text(node.value));
+		else
+			s << "#" << node.value;
+		s << "')";
 		return true;
 	}
 
@@ -458,12 +480,15 @@ private:
 		s << indent() << "(type ";
 		if (node.is_const)
 			s << "const ";
-		s << pos(node) << " '" << node.name << "')";
+		s << pos(node) << " '" << name(node.name) << "')";
 		return true;
 	}
 
 	bool visit(TU& node)
 	{
+		sources = &node.sources;
+		interner = &node.interner;
+		literals = &node.literals;
 		s << indent() << "(tu '" << node.fn << "'\n";
 		indent_level++;
 		for (size_t i=0; i < node.stmts.size(); i++)
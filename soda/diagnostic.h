@@ -0,0 +1,25 @@
+#ifndef SODA_DIAGNOSTIC_H
+#define SODA_DIAGNOSTIC_H
+
+#include <cstddef>
+#include <vector>
+
+namespace Soda
+{
+
+// A problem with the input that doesn't stop it being compiled, such as
+// malformed UTF-8. The offset is relative to the file it was found in and
+// the message is a static string, so recording one doesn't allocate.
+struct Diagnostic
+{
+	size_t offset;
+	const char *message;
+	Diagnostic(size_t offset, const char *message)
+		: offset(offset), message(message) {}
+};
+
+typedef std::vector<Diagnostic> DiagnosticList;
+
+} // namespace Soda
+
+#endif // SODA_DIAGNOSTIC_H
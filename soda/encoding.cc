@@ -0,0 +1,290 @@
+#include <soda/sodainc.h> // pch
+#include <soda/encoding.h>
+#include <soda/cpudispatch.h>
+#include <soda/scan.h>
+#include <algorithm>
+#include <cstdint>
+#include <utf8/utf8.h>
+
+namespace Soda
+{
+
+const char *encoding_name(Encoding enc)
+{
+	switch (enc)
+	{
+		case ENC_UTF8: return "UTF-8";
+		case ENC_UTF16LE: return "UTF-16LE";
+		case ENC_UTF16BE: return "UTF-16BE";
+		case ENC_LATIN1: return "ISO-8859-1";
+	}
+	return "unknown";
+}
+
+// How much of a BOM-less input the heuristic looks at
+static const size_t SAMPLE_SIZE = 4096;
+
+Encoding detect_encoding(const char *begin, const char *end, bool partial)
+{
+	const unsigned char *u = reinterpret_cast<const unsigned char*>(begin);
+	size_t len = end - begin;
+
+	if (len >= 3 && u[0] == 0xEF && u[1] == 0xBB && u[2] == 0xBF)
+		return ENC_UTF8;
+	if (len >= 2 && u[0] == 0xFF && u[1] == 0xFE)
+		return ENC_UTF16LE;
+	if (len >= 2 && u[0] == 0xFE && u[1] == 0xFF)
+		return ENC_UTF16BE;
+
+	// Source text is mostly ASCII, which in UTF-16 leaves every other
+	// byte zero
+	size_t n = std::min(len, SAMPLE_SIZE);
+	size_t zeros[2] = { 0, 0 };
+	for (size_t i = 0; i < (n & ~size_t(1)); i++)
+		zeros[i & 1] += (u[i] == 0);
+	size_t units = n / 2;
+	if (zeros[1] * 2 > units && zeros[0] * 4 < zeros[1])
+		return ENC_UTF16LE;
+	if (zeros[0] * 2 > units && zeros[1] * 4 < zeros[0])
+		return ENC_UTF16BE;
+
+	// Don't hold a sequence cut off by the end of the sample against it
+	const char *sample_end = begin + n;
+	if (partial || n < len)
+	{
+		const char *t = sample_end;
+		while (t > begin && sample_end - t < 3 &&
+		       utf8::internal::is_trail(*(t - 1)))
+			t--;
+		if (t > begin &&
+		    utf8::internal::sequence_length(t - 1) > sample_end - (t - 1))
+			sample_end = t - 1;
+	}
+	size_t valid = 0, invalid = 0;
+	const char *p = find_non_ascii(begin, sample_end);
+	while (p != sample_end)
+	{
+		char32_t cp;
+		if (decode_utf8(p, sample_end, cp))
+			valid++;
+		else
+			invalid++;
+		p = find_non_ascii(p, sample_end);
+	}
+	return (invalid > valid) ? ENC_LATIN1 : ENC_UTF8;
+}
+
+Encoding detect_encoding(const char *begin, const char *end,
+                         DiagnosticList& diagnostics, bool partial)
+{
+	Encoding enc = detect_encoding(begin, end, partial);
+	if (enc == ENC_LATIN1)
+		diagnostics.emplace_back(find_non_ascii(begin, end) - begin,
+			"not UTF-8 and no byte order mark, read as ISO-8859-1");
+	return enc;
+}
+
+namespace
+{
+
+typedef char *(*TranscodeFunc)(const char*, const char*, char*);
+
+inline char *latin1_step(const char *p, char *out)
+{
+	unsigned char ch = *p;
+	if (ch < 0x80)
+		*out++ = ch;
+	else
+	{
+		*out++ = 0xC0 | (ch >> 6);
+		*out++ = 0x80 | (ch & 0x3F);
+	}
+	return out;
+}
+
+char *latin1_to_utf8_scalar(const char *p, const char *end, char *out)
+{
+	for (; p < end; p++)
+		out = latin1_step(p, out);
+	return out;
+}
+
+template< bool BE >
+inline uint32_t utf16_unit(const char *p)
+{
+	const unsigned char *u = reinterpret_cast<const unsigned char*>(p);
+	return BE ? (u[0] << 8 | u[1]) : (u[1] << 8 | u[0]);
+}
+
+// Convert the code point at p, which may be a surrogate pair, and advance
+template< bool BE >
+inline char *utf16_step(const char *&p, const char *end, char *out)
+{
+	uint32_t cp = utf16_unit<BE>(p);
+	p += 2;
+	if (cp >= 0xD800 && cp < 0xE000)
+	{
+		uint32_t lo;
+		if (cp < 0xDC00 && end - p >= 2 &&
+		    (lo = utf16_unit<BE>(p)) >= 0xDC00 && lo < 0xE000)
+		{
+			cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+			p += 2;
+		}
+		else
+			cp = 0xFFFD;
+	}
+	return utf8::unchecked::append(cp, out);
+}
+
+template< bool BE >
+char *utf16_to_utf8_scalar(const char *p, const char *end, char *out)
+{
+	while (end - p >= 2)
+		out = utf16_step<BE>(p, end, out);
+	if (p != end)
+		out = utf8::unchecked::append(0xFFFD, out);
+	return out;
+}
+
+#if SODA_X86
+
+// Blocks that are all ASCII are copied (Latin-1) or narrowed (UTF-16)
+// whole, the others are converted a code point at a time.
+
+__attribute__((target("sse2")))
+char *latin1_to_utf8_sse2(const char *p, const char *end, char *out)
+{
+	while (end - p >= 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		if (_mm_movemask_epi8(v) == 0)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+			out += 16;
+			p += 16;
+		}
+		else
+			for (const char *blk_end = p + 16; p < blk_end; p++)
+				out = latin1_step(p, out);
+	}
+	return latin1_to_utf8_scalar(p, end, out);
+}
+
+__attribute__((target("avx2")))
+char *latin1_to_utf8_avx2(const char *p, const char *end, char *out)
+{
+	while (end - p >= 32)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		if (_mm256_movemask_epi8(v) == 0)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+			out += 32;
+			p += 32;
+		}
+		else
+			for (const char *blk_end = p + 32; p < blk_end; p++)
+				out = latin1_step(p, out);
+	}
+	return latin1_to_utf8_sse2(p, end, out);
+}
+
+template< bool BE >
+__attribute__((target("sse2")))
+char *utf16_to_utf8_sse2(const char *p, const char *end, char *out)
+{
+	const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+	const __m128i zero = _mm_setzero_si128();
+	while (end - p >= 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		if (BE)
+			v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		__m128i hi = _mm_cmpeq_epi8(_mm_and_si128(v, non_ascii), zero);
+		if (_mm_movemask_epi8(hi) == 0xFFFF)
+		{
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(out),
+			                 _mm_packus_epi16(v, v));
+			out += 8;
+			p += 16;
+		}
+		else
+			for (const char *blk_end = p + 16; p < blk_end; )
+				out = utf16_step<BE>(p, end, out);
+	}
+	return utf16_to_utf8_scalar<BE>(p, end, out);
+}
+
+template< bool BE >
+__attribute__((target("avx2")))
+char *utf16_to_utf8_avx2(const char *p, const char *end, char *out)
+{
+	const __m256i non_ascii = _mm256_set1_epi16(static_cast<short>(0xFF80));
+	while (end - p >= 32)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		if (BE)
+			v = _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8));
+		if (_mm256_testz_si256(v, non_ascii))
+		{
+			// packus works per 128-bit lane, gather the two low halves
+			__m256i packed = _mm256_permute4x64_epi64(
+				_mm256_packus_epi16(v, v), 0x08);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+			                 _mm256_castsi256_si128(packed));
+			out += 16;
+			p += 32;
+		}
+		else
+			for (const char *blk_end = p + 32; p < blk_end; )
+				out = utf16_step<BE>(p, end, out);
+	}
+	return utf16_to_utf8_sse2<BE>(p, end, out);
+}
+
+#endif // SODA_X86
+
+const TranscodeFunc latin1_to_utf8_impl = SELECT(latin1_to_utf8);
+const TranscodeFunc utf16le_to_utf8_impl = SELECT(utf16_to_utf8, <false>);
+const TranscodeFunc utf16be_to_utf8_impl = SELECT(utf16_to_utf8, <true>);
+
+} // anonymous namespace
+
+size_t utf8_size_bound(Encoding enc, size_t len)
+{
+	switch (enc)
+	{
+		case ENC_LATIN1:
+			return len * 2;
+		case ENC_UTF16LE:
+		case ENC_UTF16BE:
+			// BMP units take up to 3 bytes, pairs take 4 for 4, plus a
+			// replacement for an odd byte
+			return len / 2 * 3 + 3;
+		default:
+			return len;
+	}
+}
+
+char *transcode_to_utf8(Encoding enc, const char *begin, const char *end,
+                        char *out)
+{
+	switch (enc)
+	{
+		case ENC_LATIN1:
+			return latin1_to_utf8_impl(begin, end, out);
+		case ENC_UTF16LE:
+			if (end - begin >= 2 && utf16_unit<false>(begin) == 0xFEFF)
+				begin += 2;
+			return utf16le_to_utf8_impl(begin, end, out);
+		case ENC_UTF16BE:
+			if (end - begin >= 2 && utf16_unit<true>(begin) == 0xFEFF)
+				begin += 2;
+			return utf16be_to_utf8_impl(begin, end, out);
+		default:
+			return std::copy(begin, end, out);
+	}
+}
+
+} // namespace Soda
@@ -0,0 +1,114 @@
+#ifndef SODA_ENCODING_H
+#define SODA_ENCODING_H
+
+#include <soda/diagnostic.h>
+#include <cstddef>
+#include <uchar.h>
+
+namespace Soda
+{
+
+// Source encodings Input accepts, everything else is transcoded to UTF-8
+// before it's decoded.
+enum Encoding
+{
+	ENC_UTF8,
+	ENC_UTF16LE,
+	ENC_UTF16BE,
+	ENC_LATIN1,
+};
+
+const char *encoding_name(Encoding enc);
+
+// Decode the UTF-8 sequence at p into cp and advance past it. A malformed
+// sequence isn't an error, it returns false with cp set to U+FFFD and p
+// advanced past the longest prefix that could have started a valid
+// sequence (at least one byte), the usual way of substituting them.
+inline bool decode_utf8(const char *&p, const char *end, char32_t& cp)
+{
+	const unsigned char *s = reinterpret_cast<const unsigned char*>(p);
+	size_t avail = end - p;
+	unsigned char c = s[0];
+	cp = 0xFFFD;
+	if (c < 0x80)
+	{
+		cp = c;
+		p += 1;
+		return true;
+	}
+	if (c < 0xC2 || c > 0xF4) // trail byte, overlong lead or out of range
+	{
+		p += 1;
+		return false;
+	}
+	// the second byte's range also rules out overlongs, surrogates and
+	// code points past U+10FFFF
+	unsigned char lo = 0x80, hi = 0xBF;
+	if (c == 0xE0)
+		lo = 0xA0;
+	else if (c == 0xED)
+		hi = 0x9F;
+	else if (c == 0xF0)
+		lo = 0x90;
+	else if (c == 0xF4)
+		hi = 0x8F;
+	if (avail < 2 || s[1] < lo || s[1] > hi)
+	{
+		p += 1;
+		return false;
+	}
+	if (c < 0xE0)
+	{
+		cp = ((c & 0x1F) << 6) | (s[1] & 0x3F);
+		p += 2;
+		return true;
+	}
+	if (avail < 3 || (s[2] & 0xC0) != 0x80)
+	{
+		p += 2;
+		return false;
+	}
+	if (c < 0xF0)
+	{
+		cp = ((c & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+		p += 3;
+		return true;
+	}
+	if (avail < 4 || (s[3] & 0xC0) != 0x80)
+	{
+		p += 3;
+		return false;
+	}
+	cp = ((c & 0x07) << 18) | ((s[1] & 0x3F) << 12) |
+	     ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+	p += 4;
+	return true;
+}
+
+// Guess the encoding of [begin, end) from its BOM or, without one, from
+// the first few kilobytes: mostly-zero odd or even bytes mean UTF-16, and
+// more malformed than well-formed UTF-8 multibyte sequences mean Latin-1
+// (a few bad bytes in otherwise good UTF-8 are just corruption). When
+// partial, [begin, end) is only the start of the input and a sequence cut
+// off at end isn't held against it.
+Encoding detect_encoding(const char *begin, const char *end,
+                         bool partial=false);
+// The same, but ISO-8859-1 is only ever a guess, so taking the input for
+// it is noted in diagnostics (where it stops being ASCII). Stray bytes in
+// what was meant to be UTF-8 would otherwise be read as other letters
+// without a word.
+Encoding detect_encoding(const char *begin, const char *end,
+                         DiagnosticList& diagnostics, bool partial=false);
+
+// Most bytes len bytes of enc can take up in UTF-8
+size_t utf8_size_bound(Encoding enc, size_t len);
+
+// Convert [begin, end) from enc to UTF-8 at out, which must have room for
+// utf8_size_bound() bytes, and return the end of the output. A UTF-16 BOM
+// is dropped, unpaired surrogates and a trailing odd byte become U+FFFD.
+char *transcode_to_utf8(Encoding enc, const char *begin, const char *end,
+                        char *out);
+
+} // namespace Soda
+
+#endif // SODA_ENCODING_H
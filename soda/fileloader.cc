@@ -0,0 +1,530 @@
+#include <soda/sodainc.h> // pch
+#include <soda/fileloader.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  define SODA_IO_URING 1
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+# endif
+#endif
+#ifndef SODA_IO_URING
+# define SODA_IO_URING 0
+#endif
+
+namespace Soda
+{
+
+namespace
+{
+
+// Largest single read, bigger files take several
+const size_t CHUNK_SIZE = 4 * 1024 * 1024;
+// Most reads kept queued at once
+const unsigned QUEUE_DEPTH = 64;
+// Most threads reading at once without io_uring
+const unsigned MAX_THREADS = 8;
+// Most times a submission the kernel is too busy for is tried again
+const unsigned MAX_SUBMIT_RETRIES = 1000;
+
+// See fail_io_uring_submits()
+std::atomic<int> submit_error(0), submits_to_fail(0);
+std::atomic<unsigned> submits_to_pass(0);
+
+enum State
+{
+	PENDING,
+	READY,
+	FAILED,
+	UNBUFFERED, // not a regular file, left for SourceBuffer to read
+};
+
+struct File
+{
+	std::string name;
+	int fd;
+	size_t size, done;
+	std::unique_ptr<char[]> data;
+	bool reading; // a read into data is queued
+	State state; // guarded by LoadImpl::lock
+	File(const std::string& name)
+		: name(name), fd(-1), size(0), done(0), reading(false),
+		  state(PENDING) {}
+};
+
+// Open a file and allocate room for it, returning PENDING if it's ready to
+// be read or the state it ends up in otherwise
+State open_file(File& file)
+{
+	file.fd = ::open(file.name.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file.fd < 0)
+		return FAILED;
+	struct stat st;
+	if (::fstat(file.fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+	{
+		// pipes, devices and empty files go through SourceBuffer
+		::close(file.fd);
+		file.fd = -1;
+		return UNBUFFERED;
+	}
+	file.size = st.st_size;
+	file.data.reset(new char[file.size]);
+	return PENDING;
+}
+
+// Read the rest of an opened file synchronously
+State read_rest(File& file)
+{
+	while (file.done < file.size)
+	{
+		size_t want = std::min(file.size - file.done, CHUNK_SIZE);
+		ssize_t n = ::pread(file.fd, file.data.get() + file.done, want, file.done);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return FAILED;
+		}
+		if (n == 0) // truncated since it was opened
+			file.size = file.done;
+		file.done += n;
+	}
+	return READY;
+}
+
+void close_file(File& file)
+{
+	if (file.fd >= 0)
+		::close(file.fd);
+	file.fd = -1;
+}
+
+#if SODA_IO_URING
+
+bool inject_submit_failure()
+{
+	if (submits_to_fail == 0)
+		return false;
+	if (submits_to_pass > 0)
+	{
+		submits_to_pass--;
+		return false;
+	}
+	if (submits_to_fail > 0)
+		submits_to_fail--;
+	errno = submit_error;
+	return true;
+}
+
+// Just enough of an io_uring to queue reads and collect their results,
+// talking to the kernel directly rather than through liburing.
+class Ring
+{
+public:
+	Ring()
+		: fd(-1), sq_ptr(MAP_FAILED), cq_ptr(MAP_FAILED), sqes_ptr(MAP_FAILED),
+		  sq_len(0), cq_len(0), sqes_len(0), unsubmitted(0)
+	{
+	}
+
+	~Ring()
+	{
+		if (sqes_ptr != MAP_FAILED)
+			::munmap(sqes_ptr, sqes_len);
+		if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+			::munmap(cq_ptr, cq_len);
+		if (sq_ptr != MAP_FAILED)
+			::munmap(sq_ptr, sq_len);
+		if (fd >= 0)
+			::close(fd);
+	}
+
+	bool setup(unsigned entries)
+	{
+		io_uring_params p;
+		std::memset(&p, 0, sizeof(p));
+		fd = ::syscall(__NR_io_uring_setup, entries, &p);
+		if (fd < 0)
+			return false;
+
+		sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+		bool single = (p.features & IORING_FEAT_SINGLE_MMAP);
+		if (single)
+			sq_len = cq_len = std::max(sq_len, cq_len);
+		sq_ptr = map(sq_len, IORING_OFF_SQ_RING);
+		if (sq_ptr == MAP_FAILED)
+			return false;
+		cq_ptr = single ? sq_ptr : map(cq_len, IORING_OFF_CQ_RING);
+		if (cq_ptr == MAP_FAILED)
+			return false;
+		sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+		sqes_ptr = map(sqes_len, IORING_OFF_SQES);
+		if (sqes_ptr == MAP_FAILED)
+			return false;
+
+		char *sq = static_cast<char*>(sq_ptr), *cq = static_cast<char*>(cq_ptr);
+		sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+		sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+		sq_mask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+		sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+		sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+		cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+		cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+		cq_mask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+		capacity = std::min(p.sq_entries, p.cq_entries);
+		return true;
+	}
+
+	// The caller keeps no more than capacity reads in flight, so there's
+	// always room in both rings
+	void queue_read(int file_fd, char *buf, size_t len, size_t off,
+	                uint64_t user_data)
+	{
+		unsigned tail = *sq_tail;
+		unsigned slot = tail & sq_mask;
+		io_uring_sqe *sqe = &sqes[slot];
+		std::memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = file_fd;
+		sqe->addr = reinterpret_cast<uint64_t>(buf);
+		sqe->len = len;
+		sqe->off = off;
+		sqe->user_data = user_data;
+		sq_array[slot] = slot;
+		__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+		unsubmitted++;
+	}
+
+	// Hand the queued reads to the kernel and wait for at least wait_for
+	// of them to complete. False if it won't take them, those it hasn't
+	// can then be taken back with unqueue().
+	bool submit(unsigned wait_for)
+	{
+		unsigned flags = wait_for ? IORING_ENTER_GETEVENTS : 0;
+		unsigned retries = 0;
+		for (;;)
+		{
+			int ret = inject_submit_failure() ? -1 :
+				::syscall(__NR_io_uring_enter, fd, unsubmitted, wait_for,
+				          flags, nullptr, 0);
+			if (ret < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				// short of memory for now, or completions to be taken
+				// first, which the caller does before submitting again
+				if ((errno == EAGAIN || errno == EBUSY) &&
+				    retries++ < MAX_SUBMIT_RETRIES)
+				{
+					if (wait_for && completed())
+						return true;
+					std::this_thread::yield();
+					continue;
+				}
+				return false;
+			}
+			unsubmitted -= ret;
+			return true;
+		}
+	}
+
+	// Take back the last read queued but not yet submitted, if there is
+	// one
+	bool unqueue(uint64_t& user_data)
+	{
+		if (unsubmitted == 0)
+			return false;
+		unsigned tail = *sq_tail - 1;
+		user_data = sqes[sq_array[tail & sq_mask]].user_data;
+		__atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+		unsubmitted--;
+		return true;
+	}
+
+	bool completed() const
+	{
+		return *cq_head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+	}
+
+	// Take the next completion, if there is one
+	bool complete(uint64_t& user_data, int& res)
+	{
+		unsigned head = *cq_head;
+		if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+			return false;
+		io_uring_cqe *cqe = &cqes[head & cq_mask];
+		user_data = cqe->user_data;
+		res = cqe->res;
+		__atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	unsigned capacity;
+
+private:
+	int fd;
+	void *sq_ptr, *cq_ptr, *sqes_ptr;
+	size_t sq_len, cq_len, sqes_len;
+	unsigned *sq_head, *sq_tail, *sq_array, sq_mask;
+	unsigned *cq_head, *cq_tail, cq_mask;
+	io_uring_sqe *sqes;
+	io_uring_cqe *cqes;
+	unsigned unsubmitted;
+
+	void *map(size_t len, off_t offset)
+	{
+		return ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+		              MAP_SHARED | MAP_POPULATE, fd, offset);
+	}
+};
+
+#endif // SODA_IO_URING
+
+} // anonymous namespace
+
+struct FileLoader::LoadImpl
+{
+
+std::vector<File> files;
+std::mutex lock;
+std::condition_variable ready;
+std::vector<std::thread> threads;
+std::atomic<size_t> next_file;
+std::atomic<bool> stop;
+bool uring;
+
+LoadImpl(const std::vector<std::string>& filenames, Method method)
+	: next_file(0), stop(false), uring(false)
+{
+	for (auto& name : filenames)
+		files.emplace_back(name);
+	if (files.empty())
+		return;
+#if SODA_IO_URING
+	if (method != LOAD_THREADS)
+	{
+		std::unique_ptr<Ring> ring(new Ring);
+		if (ring->setup(std::min<size_t>(QUEUE_DEPTH, files.size())))
+		{
+			uring = true;
+			Ring *r = ring.release();
+			threads.emplace_back([this, r]() { load_uring(r); });
+			return;
+		}
+	}
+#else
+	(void)method;
+#endif
+	unsigned n = std::max(1u, std::thread::hardware_concurrency());
+	n = std::min<size_t>(std::min(n, MAX_THREADS), files.size());
+	for (unsigned i = 0; i < n; i++)
+		threads.emplace_back([this]() { load_threads(); });
+}
+
+~LoadImpl()
+{
+	stop = true;
+	for (auto& thread : threads)
+		thread.join();
+	for (auto& file : files)
+		close_file(file);
+}
+
+void publish(size_t index, State state)
+{
+	close_file(files[index]);
+	std::lock_guard<std::mutex> guard(lock);
+	files[index].state = state;
+	ready.notify_all();
+}
+
+// Each thread takes the next file not yet started and reads all of it
+void load_threads()
+{
+	size_t index;
+	while (!stop && (index = next_file++) < files.size())
+	{
+		State state = open_file(files[index]);
+		if (state == PENDING)
+			state = read_rest(files[index]);
+		publish(index, state);
+	}
+}
+
+#if SODA_IO_URING
+// Open files and queue their first reads while there's room, then collect
+// completions, queueing the next chunk of any file not yet finished
+void load_uring(Ring *r)
+{
+	std::unique_ptr<Ring> ring(r);
+	size_t next = 0, finished = 0;
+	unsigned in_flight = 0;
+
+	auto queue = [&](size_t index) {
+		File& file = files[index];
+		size_t len = std::min(file.size - file.done, CHUNK_SIZE);
+		ring->queue_read(file.fd, file.data.get() + file.done, len,
+		                 file.done, index);
+		file.reading = true;
+		in_flight++;
+	};
+
+	while (finished < files.size())
+	{
+		while (!stop && next < files.size() && in_flight < ring->capacity)
+		{
+			State state = open_file(files[next]);
+			if (state == PENDING)
+				queue(next);
+			else
+			{
+				publish(next, state);
+				finished++;
+			}
+			next++;
+		}
+		if (in_flight == 0)
+			break;
+		if (!ring->submit(1))
+		{
+			// the reads the kernel never took are done here instead
+			uint64_t index;
+			while (ring->unqueue(index))
+			{
+				in_flight--;
+				files[index].reading = false;
+				publish(index, stop ? FAILED : read_rest(files[index]));
+				finished++;
+			}
+			break;
+		}
+
+		uint64_t index;
+		int res;
+		while (ring->complete(index, res))
+		{
+			in_flight--;
+			File& file = files[index];
+			file.reading = false;
+			State state = PENDING;
+			if (res == -EINTR || res == -EAGAIN)
+				;
+			else if (res == -EINVAL || res == -EOPNOTSUPP) // no IORING_OP_READ
+				state = read_rest(file);
+			else if (res < 0)
+				state = FAILED;
+			else if (res == 0) // truncated since it was opened
+			{
+				file.size = file.done;
+				state = READY;
+			}
+			else if ((file.done += res) == file.size)
+				state = READY;
+
+			if (state == PENDING && !stop)
+				queue(index);
+			else
+			{
+				publish(index, (state == PENDING) ? FAILED : state);
+				finished++;
+			}
+		}
+	}
+
+	// reads the kernel took but that can't be waited for any more may
+	// still write to their buffers, so those are leaked and the files
+	// finished in new ones
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		File& file = files[i];
+		if (!file.reading)
+			continue;
+		file.reading = false;
+		char *busy = file.data.release();
+		if (stop)
+		{
+			publish(i, FAILED);
+			continue;
+		}
+		file.data.reset(new char[file.size]);
+		std::memcpy(file.data.get(), busy, file.done);
+		publish(i, read_rest(file));
+	}
+	// if the ring gave up, the files it never got to are read here the
+	// way the thread pool would, so take() doesn't wait on them forever
+	for (; next < files.size(); next++)
+	{
+		State state = stop ? FAILED : open_file(files[next]);
+		if (state == PENDING)
+			state = read_rest(files[next]);
+		publish(next, state);
+	}
+}
+#endif // SODA_IO_URING
+
+}; // struct FileLoader::LoadImpl
+
+FileLoader::FileLoader(const std::vector<std::string>& filenames, Method method)
+	: impl(new LoadImpl(filenames, method))
+{
+}
+
+FileLoader::~FileLoader()
+{
+	delete impl;
+}
+
+size_t FileLoader::size() const
+{
+	return impl->files.size();
+}
+
+bool FileLoader::using_io_uring() const
+{
+	return impl->uring;
+}
+
+void fail_io_uring_submits(int error, unsigned pass, int count)
+{
+	submit_error = error;
+	submits_to_pass = pass;
+	submits_to_fail = count;
+}
+
+std::unique_ptr<SourceBuffer> FileLoader::take(size_t index)
+{
+	File& file = impl->files[index];
+	State state;
+	{
+		std::unique_lock<std::mutex> guard(impl->lock);
+		impl->ready.wait(guard, [&]() { return file.state != PENDING; });
+		state = file.state;
+		file.state = FAILED; // taken
+	}
+
+	std::unique_ptr<SourceBuffer> buf;
+	if (state == READY)
+		buf.reset(new SourceBuffer(std::move(file.data), file.size));
+	else if (state == UNBUFFERED)
+	{
+		buf.reset(new SourceBuffer(file.name));
+		if (!buf->is_open())
+			buf.reset();
+	}
+	return buf;
+}
+
+} // namespace Soda
@@ -0,0 +1,52 @@
+#ifndef SODA_FILELOADER_H
+#define SODA_FILELOADER_H
+
+#include <soda/sourcebuffer.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Soda
+{
+
+// Loads a batch of source files in the background, so the first can be
+// parsed while the rest are still being read. Where the kernel supports
+// io_uring every read is queued to it from a single thread, otherwise the
+// files are spread across a small pool of threads doing pread(). Files are
+// started in order, so the first one is normally ready first.
+class FileLoader
+{
+public:
+	enum Method
+	{
+		LOAD_AUTO,    // io_uring if available, else threads
+		LOAD_THREADS, // always use the thread pool
+	};
+
+	FileLoader(const std::vector<std::string>& filenames,
+	           Method method=LOAD_AUTO);
+	~FileLoader();
+
+	size_t size() const;
+	// Whether io_uring ended up doing the reads
+	bool using_io_uring() const;
+	// Wait for a file to finish loading and take its buffer, nullptr if
+	// it couldn't be opened or read. Each file can be taken once.
+	std::unique_ptr<SourceBuffer> take(size_t index);
+
+private:
+	struct LoadImpl;
+	LoadImpl *impl;
+	FileLoader(const FileLoader&);
+	FileLoader& operator=(const FileLoader&);
+};
+
+// For testing: make io_uring submissions fail with error, as though the
+// kernel had refused them. The next pass go through, then count fail, or
+// all the rest if count is negative. A count of 0 turns it off.
+void fail_io_uring_submits(int error, unsigned pass=0, int count=-1);
+
+} // namespace Soda
+
+#endif // SODA_FILELOADER_H
@@ -0,0 +1,133 @@
+#include <soda/sodainc.h> // pch
+#include <soda/highlighter.h>
+#include <soda/lexer.h>
+
+namespace Soda
+{
+
+static HighlightClass classify(Token::Kind kind)
+{
+	switch (kind)
+	{
+		case Token::IDENT:
+			return HL_IDENT;
+		case Token::HEX_ICONST:
+		case Token::BIN_ICONST:
+		case Token::OCT_ICONST:
+		case Token::DEC_ICONST:
+		case Token::FCONST:
+			return HL_NUMBER;
+		case Token::CHAR_ICONST:
+		case Token::STR_LIT:
+			return HL_STRING;
+		case Token::COMMENT:
+			return HL_COMMENT;
+		case Token::END:
+		case Token::ERROR:
+		case Token::ZERO:
+			return HL_ERROR;
+		default:
+			break;
+	}
+	// the keywords are the two runs STRUCT to CCODE and CONST to INTERNAL
+	if ((kind >= Token::STRUCT && kind <= Token::CCODE) ||
+	    (kind >= Token::CONST && kind <= Token::INTERNAL))
+		return HL_KEYWORD;
+	return HL_OPERATOR;
+}
+
+// The class of each compact kind (see tokenlist.h), so classifying a token
+// is a lookup
+struct HighlightClasses
+{
+	HighlightClass classes[256];
+	HighlightClasses()
+	{
+		for (int code = 0; code < 256; code++)
+			classes[code] = classify(expand_kind(code));
+	}
+};
+
+static const HighlightClass *highlight_classes()
+{
+	// built on first use, after kind_codes
+	static const HighlightClasses table;
+	return table.classes;
+}
+
+// The source text a token was lexed from, which its location leaves the
+// quotes or base prefix out of
+static void token_extent(Token::Kind kind, const SourceLocation& loc,
+                         size_t& start, size_t& end)
+{
+	start = loc.start();
+	end = loc.end();
+	switch (kind)
+	{
+		case Token::STR_LIT:
+		case Token::CHAR_ICONST:
+			start -= 1;
+			end += 1;
+			break;
+		case Token::HEX_ICONST:
+		case Token::BIN_ICONST:
+		case Token::OCT_ICONST:
+			start -= 2;
+			break;
+		default:
+			break;
+	}
+}
+
+static void set_span(HighlightSpan& span, size_t start, size_t end,
+                     HighlightClass kind)
+{
+	span.offset = static_cast<uint32_t>(start);
+	span.length = static_cast<uint32_t>(end - start);
+	span.kind = kind;
+}
+
+size_t highlight(const char *begin, const char *end, size_t from, size_t to,
+                 HighlightSpan *spans, size_t capacity)
+{
+	const HighlightClass *classes = highlight_classes();
+	Lexer lex(begin + from, end, ENC_UTF8, from);
+	// the comments skipped on the way to each token
+	TriviaList comments;
+	lex.keep_trivia(&comments);
+
+	size_t n = 0;
+	for (;;)
+	{
+		Token::Kind kind = lex.next();
+		for (const Trivia& comment : comments)
+		{
+			if (n == capacity || comment.location.start() >= to)
+				return n;
+			set_span(spans[n++], comment.location.start(),
+			         comment.location.end(), HL_COMMENT);
+		}
+		comments.clear();
+
+		if (kind == Token::END)
+			return n;
+		size_t start, stop;
+		token_extent(kind, lex.token.location, start, stop);
+		if (n == capacity || start >= to)
+			return n;
+		set_span(spans[n++], start, stop, classes[compact_kind(kind)]);
+	}
+}
+
+size_t highlight_start(const TokenList& tokens, size_t offset)
+{
+	size_t next = tokens.find(offset);
+	if (next == 0)
+		return 0;
+	size_t start, end;
+	token_extent(tokens.kind(next - 1), tokens.location(next - 1), start, end);
+	// from the token offset is in, or else just past the one before it
+	return (end > offset) ? start : end;
+}
+
+} // namespace Soda
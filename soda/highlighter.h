@@ -0,0 +1,48 @@
+#ifndef SODA_HIGHLIGHTER_H
+#define SODA_HIGHLIGHTER_H
+
+#include <soda/tokenlist.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace Soda
+{
+
+enum HighlightClass : uint8_t
+{
+	HL_KEYWORD,
+	HL_IDENT,
+	HL_NUMBER,
+	HL_STRING,   // string and character literals
+	HL_COMMENT,
+	HL_OPERATOR, // operators and punctuation
+	HL_ERROR,
+};
+
+// A stretch of source text and how to show it. Unlike a token's location
+// it covers everything in the source, quotes and 0x/0b/0o included.
+struct HighlightSpan
+{
+	uint32_t offset, length;
+	HighlightClass kind;
+};
+
+// Classify the tokens and comments of the UTF-8 buffer [begin, end) that
+// start in [from, to) into spans, in order, writing at most capacity of
+// them and returning how many. Nothing is allocated per token, so it's
+// quick enough to redo a viewport on every keystroke.
+//
+// Lexing starts at from, which has to be somewhere it could start: the
+// start of the buffer or of a line outside any comment or literal, or as
+// given by highlight_start(). If spans runs out, the end of the last one
+// is such a place to carry on from.
+size_t highlight(const char *begin, const char *end, size_t from, size_t to,
+                 HighlightSpan *spans, size_t capacity);
+
+// Where highlight() can start to cover offset, given the buffer's tokens
+// (from tokenize() and kept up to date by relex())
+size_t highlight_start(const TokenList& tokens, size_t offset);
+
+} // namespace Soda
+
+#endif // SODA_HIGHLIGHTER_H
@@ -1,86 +1,422 @@
 #include <soda/sodainc.h> // pch
 #include <soda/input.h>
+#include <soda/scan.h>
 #include <soda/utils.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <utf8/utf8.h>
 
 namespace Soda
 {
 
-Input::Input(std::istream& stream)
-	:  position(0,0,0),
-	   last(0),
-	   stream(stream),
-	   iter(stream.rdbuf()),
-	   has_peeked(false),
-	   peeked(0)
+// Most bytes decode() looks ahead for the end of an ASCII run
+static const size_t ASCII_SCAN = 4096;
+
+void StreamText::clear()
 {
+	text.clear();
+	pieces.assign(1, Piece{0, 0});
+	end_offset = 0;
+	keep = 0;
 }
 
-void Input::skip_whitespace()
+bool StreamText::whole() const
 {
-	while (is_whitespace(last))
-		last = next();
+	return pieces.size() == 1 && pieces[0].offset == 0;
 }
 
-bool Input::eof() const
+// The index in text of offset, in the last piece starting at or before it
+size_t StreamText::index(size_t offset) const
 {
-	return stream.eof();
+	assert(offset >= pieces[0].offset && offset <= end_offset);
+	auto it = std::upper_bound(pieces.begin(), pieces.end(), offset,
+		[](size_t off, const Piece& p) { return off < p.offset; });
+	--it;
+	return it->index + (offset - it->offset);
 }
 
-char32_t Input::next()
+const char *StreamText::at(size_t offset) const
+{
+	return text.data() + index(offset);
+}
+
+// The front is dropped once it's more than half of what's held, so each
+// byte is only moved along a few times
+void StreamText::append(const char *begin, const char *end)
+{
+	text.append(begin, end);
+	end_offset += end - begin;
+	if (keep <= pieces[0].offset)
+		return;
+	size_t drop = index(std::min(keep, end_offset));
+	if (drop <= text.size() / 2)
+		return;
+	text.erase(0, drop);
+	size_t first = 0;
+	while (first + 1 < pieces.size() && pieces[first + 1].offset <= keep)
+		first++;
+	pieces.erase(pieces.begin(), pieces.begin() + first);
+	pieces[0].offset = keep;
+	pieces[0].index = 0;
+	for (size_t i = 1; i < pieces.size(); i++)
+		pieces[i].index -= drop;
+}
+
+void StreamText::cut(size_t from, size_t to)
+{
+	from = std::max(from, pieces[0].offset);
+	if (from >= to)
+		return;
+	size_t begin = index(from), end = index(to);
+	text.erase(begin, end - begin);
+	// the pieces starting in [from, to] give way to one starting at to
+	size_t i = 0;
+	while (i < pieces.size() && pieces[i].offset < from)
+		i++;
+	size_t j = i;
+	while (j < pieces.size() && pieces[j].offset <= to)
+		j++;
+	for (size_t k = j; k < pieces.size(); k++)
+		pieces[k].index -= end - begin;
+	pieces.erase(pieces.begin() + i, pieces.begin() + j);
+	pieces.insert(pieces.begin() + i, Piece{to, begin});
+}
+
+Input::Input(const char *begin, const char *end, LineTable *lines)
+	:  stream(nullptr),
+	   stream_copy(nullptr),
+	   window_size(0)
+{
+	reset(begin, end, lines);
+}
+
+Input::Input(const char *begin, const char *end, Encoding encoding,
+             LineTable *lines)
+	:  stream(nullptr),
+	   stream_copy(nullptr),
+	   window_size(0)
+{
+	reset(begin, end, encoding, lines);
+}
+
+void Input::reset(const char *begin, const char *end, Encoding encoding,
+                  LineTable *lines)
+{
+	offset = 0;
+	trivia_from = NO_TRIVIA;
+	last = 0;
+	this->encoding = encoding;
+	diagnostics.clear();
+	base = cur = ascii_lim = begin;
+	lim = end;
+	base_offset = 0;
+	stream = nullptr;
+	stream_copy = nullptr;
+	window.reset();
+	window_size = 0;
+	scanned = end - begin;
+	at_eof = true;
+	this->lines = lines;
+	ahead_head = ahead_count = 0;
+	if (encoding != ENC_UTF8)
+		transcode(begin, end);
+	if (lines)
+		lines->scan(base, lim);
+}
+
+void Input::reset(const char *begin, const char *end, LineTable *lines)
+{
+	DiagnosticList guessed;
+	reset(begin, end, detect_encoding(begin, end, guessed), lines);
+	diagnostics.insert(diagnostics.end(), guessed.begin(), guessed.end());
+}
+
+Input::Input(std::istream& stream, LineTable *lines, size_t window_size,
+             StreamText *copy)
+	:  offset(0),
+	   trivia_from(NO_TRIVIA),
+	   last(0),
+	   encoding(ENC_UTF8),
+	   base(nullptr),
+	   cur(nullptr),
+	   lim(nullptr),
+	   ascii_lim(nullptr),
+	   base_offset(0),
+	   stream(&stream),
+	   stream_copy(copy),
+	   window(new char[window_size]),
+	   window_size(window_size),
+	   scanned(0),
+	   at_eof(false),
+	   lines(lines),
+	   ahead_head(0),
+	   ahead_count(0)
 {
-	if (has_peeked)
+	assert(window_size >= 4); // room for a whole UTF-8 sequence
+	base = cur = lim = ascii_lim = window.get();
+
+	// sniff the encoding from the first chunk
+	std::streamsize got = stream.rdbuf()->sgetn(window.get(), window_size);
+	if (got <= 0)
+		at_eof = true;
+	else
+		lim += got;
+	encoding = detect_encoding(base, lim, diagnostics, !at_eof);
+	if (encoding != ENC_UTF8)
 	{
-		has_peeked = false;
-		last = peeked;
+		std::string raw(base, lim);
+		char chunk[64 * 1024];
+		while ((got = stream.rdbuf()->sgetn(chunk, sizeof(chunk))) > 0)
+			raw.append(chunk, got);
+		transcode(raw.data(), raw.data() + raw.size());
+		if (copy)
+		{
+			copy->clear();
+			copy->append(base, lim);
+		}
 	}
-	else
+	else if (copy)
+		copy->append(base, lim);
+	scan_lines();
+}
+
+// Replace the input with [begin, end) converted to UTF-8, which is then
+// decoded like an in-memory buffer
+void Input::transcode(const char *begin, const char *end)
+{
+	text.reset(new char[utf8_size_bound(encoding, end - begin)]);
+	base = cur = ascii_lim = text.get();
+	lim = transcode_to_utf8(encoding, begin, end, text.get());
+	scanned = (stream ? 0 : lim - base);
+	stream = nullptr;
+	window.reset();
+	at_eof = true;
+}
+
+static inline bool is_ascii_space(char32_t ch)
+{
+	return (ch == ' ' || (ch >= '\t' && ch <= '\r'));
+}
+
+// ASCII whitespace is checked inline, the rest goes to the Unicode table
+static inline bool is_space(char32_t ch)
+{
+	return (ch < 0x80) ? is_ascii_space(ch) : is_whitespace(ch);
+}
+
+// Skip whitespace starting at last, leaving last at the first code point
+// that isn't. Runs of ASCII whitespace (more than the usual single space)
+// are skipped over in bulk.
+void Input::skip_whitespace()
+{
+	while (is_space(last))
 	{
-		if (eof() || stream.peek() == EOF)
-			return (last = Input::END);
-		last = utf8::next(iter, end);
-		// skip BOM, zero-width non-breaking space, or WORD JOINER
-		while (last == U'\uFEFF' || last == U'\u2060')
+		if (ahead_count == 0 && cur != lim &&
+		    is_ascii_space(static_cast<unsigned char>(*cur)))
 		{
-			if (eof() || stream.peek() == EOF)
-				return (last = Input::END);
-			last = utf8::next(iter, end);
+			while ((cur = skip_ascii_whitespace(cur, lim)) == lim &&
+			       refill(consumed()))
+				;
 		}
+		next();
 	}
+}
 
-	position.offset++;
+// Skip to the end of the line, leaving last at the line break or END.
+// Runs of ASCII are jumped over in bulk. Anything else is decoded, which
+// is how NEL, LS and PS are found and malformed UTF-8 is diagnosed.
+void Input::skip_line()
+{
+	while (last != Input::END && !is_newline(last))
+	{
+		if (ahead_count == 0)
+		{
+			while ((cur = find_ascii_line_break_or_non_ascii(cur, lim)) == lim &&
+			       refill(consumed()))
+				;
+		}
+		next();
+	}
+}
 
-	if (is_newline(last))
+// Runs of ASCII are jumped over in bulk. Anything else is decoded as usual,
+// so malformed UTF-8 is still diagnosed.
+void Input::skip_until(char a, char b)
+{
+	while (last != Input::END && last != char32_t(a) && last != char32_t(b))
 	{
-		position.line++;
-		position.column = 0;
-		if (last == '\r' && stream.peek() == '\n')
+		if (ahead_count == 0)
 		{
-			last = utf8::next(iter, end);
-			position.offset++;
+			while ((cur = find_either_or_non_ascii(cur, lim, a, b)) == lim &&
+			       refill(consumed()))
+				;
 		}
+		next();
 	}
+}
+
+bool Input::eof() const
+{
+	return (cur == lim && at_eof);
+}
+
+// Slide the undecoded tail of the window to the front and read the next
+// chunk behind it. The tail is at most a partial UTF-8 sequence, which is
+// how sequences split across reads get joined back up. Returns false if
+// nothing more could be read. Everything before done has been lexed, so the
+// whitespace and comments up to it can be cut from the copy.
+bool Input::refill(size_t done)
+{
+	if (at_eof)
+		return false;
+
+	if (stream_copy && trivia_from < done)
+	{
+		stream_copy->cut(trivia_from, done);
+		trivia_from = done;
+	}
+
+	size_t keep = lim - cur;
+	std::memmove(window.get(), cur, keep);
+	base_offset += cur - base;
+	base = cur = ascii_lim = window.get();
+	lim = base + keep;
+
+	std::streamsize want = window_size - keep;
+	std::streamsize got = stream->rdbuf()->sgetn(window.get() + keep, want);
+	if (got <= 0)
+		at_eof = true;
 	else
-		position.column++;
+	{
+		if (stream_copy)
+			stream_copy->append(lim, lim + got);
+		lim += got;
+	}
 
-	return last;
+	scan_lines();
+	return (got > 0);
+}
+
+// Record line starts for the complete code points in the window, a line
+// break is never split because a partial sequence at the end is held back
+// until the next chunk completes it.
+void Input::scan_lines()
+{
+	if (!lines)
+		return;
+	const char *begin = base + (scanned - base_offset);
+	const char *end = lim;
+	if (!at_eof)
+	{
+		const char *p = end;
+		while (p > begin && end - p < 4 && utf8::internal::is_trail(*(p - 1)))
+			p--;
+		if (p > begin && utf8::internal::sequence_length(p - 1) > end - (p - 1))
+			end = p - 1;
+	}
+	lines->scan(begin, end, scanned);
+	scanned += end - begin;
+}
+
+// Decode the next code point from the underlying buffer or stream window
+char32_t Input::decode()
+{
+	if (cur == lim && !refill(offset))
+		return Input::END;
+	// find the extent of the ASCII run starting here, next() emits
+	// those bytes directly without validating them. It's looked for a
+	// stretch at a time, so lexing a little of a big buffer (relexing or
+	// highlighting part of it) doesn't scan the rest.
+	if (cur >= ascii_lim)
+		ascii_lim = find_non_ascii(cur, cur + std::min<size_t>(lim - cur,
+		                                                       ASCII_SCAN));
+	if (cur < ascii_lim)
+		return static_cast<unsigned char>(*cur++);
+	// make sure a multibyte sequence is entirely in the window
+	if (stream && utf8::internal::sequence_length(cur) > lim - cur)
+		refill(offset);
+	const char *start = cur;
+	char32_t cp;
+	if (!decode_utf8(cur, lim, cp))
+	{
+		diagnostics.emplace_back(base_offset + (start - base),
+			"invalid UTF-8 sequence, replaced with U+FFFD");
+	}
+	return cp;
+}
+
+// Look at the next raw byte without consuming it
+int Input::peek_byte()
+{
+	if (cur == lim && !refill(offset))
+		return EOF;
+	return static_cast<unsigned char>(*cur);
 }
 
-char32_t Input::peek()
+// Read the next code point and its offset into at, skipping the invisible
+// ones and folding CR LF into LF
+inline char32_t Input::read(size_t& at)
 {
-	if (has_peeked)
+	char32_t ch;
+	if (cur < ascii_lim)
+	{
+		at = consumed();
+		ch = static_cast<unsigned char>(*cur++);
+	}
+	else
+	{
+		at = consumed();
+		ch = decode();
+		// skip BOM, zero-width non-breaking space, or WORD JOINER
+		while (ch == U'\uFEFF' || ch == U'\u2060')
+		{
+			at = consumed();
+			ch = decode();
+		}
+		if (ch == Input::END)
+			return ch;
+	}
+
+	// CR LF is returned as a single LF
+	if (ch == '\r' && peek_byte() == '\n')
 	{
-		has_peeked = false;
-		return peeked;
+		at = consumed();
+		ch = decode();
 	}
 
-	has_peeked = true;
-	if (eof() || stream.peek() == EOF)
-		peeked = Input::END;
+	return ch;
+}
+
+char32_t Input::next()
+{
+	if (ahead_count > 0)
+	{
+		last = ahead[ahead_head];
+		offset = ahead_offset[ahead_head];
+		ahead_head = (ahead_head + 1) % LOOKAHEAD;
+		ahead_count--;
+	}
+	else if (cur < ascii_lim && *cur != '\r')
+	{
+		offset = consumed();
+		last = static_cast<unsigned char>(*cur++);
+	}
 	else
-		peeked = utf8::next(iter, end);
+		last = read(offset);
+	return last;
+}
 
-	return peeked;
+char32_t Input::peek(size_t k)
+{
+	assert(k >= 1 && k <= LOOKAHEAD);
+	while (ahead_count < k)
+	{
+		size_t slot = (ahead_head + ahead_count) % LOOKAHEAD;
+		ahead[slot] = read(ahead_offset[slot]);
+		ahead_count++;
+	}
+	return ahead[(ahead_head + k - 1) % LOOKAHEAD];
 }
 
 } // namespace Soda
@@ -1,36 +1,142 @@
 #ifndef SODA_INPUT_H
 #define SODA_INPUT_H
 
-#include <soda/sourcelocation.h>
+#include <soda/diagnostic.h>
+#include <soda/encoding.h>
+#include <soda/linetable.h>
 #include <cstddef>
 #include <istream>
 #include <limits>
+#include <memory>
+#include <string>
 #include <uchar.h>
+#include <vector>
 
 namespace Soda
 {
 
+// The UTF-8 text read from a stream, kept so that token locations can be
+// turned back into text. What nothing will ask about again is let go of:
+// everything before the offset given to keep_from(), and the whitespace
+// and comments between tokens, which cut() takes out. So what's held
+// needn't grow with the stream.
+class StreamText
+{
+public:
+	StreamText() { clear(); }
+
+	// The text at offset, which has to still be held
+	const char *at(size_t offset) const;
+	// The offset one past the last byte read
+	size_t end() const { return end_offset; }
+	// The number of bytes held
+	size_t held() const { return text.size(); }
+	// Whether nothing has been let go of, so that take() is the whole
+	// stream
+	bool whole() const;
+
+	void append(const char *begin, const char *end);
+	// Drop what's before offset, next time more is appended
+	void keep_from(size_t offset) { keep = offset; }
+	// Drop [from, to), which is between tokens
+	void cut(size_t from, size_t to);
+	void clear();
+	std::string take() { return std::move(text); }
+
+private:
+	// Where a stretch of the stream between cuts starts in text
+	struct Piece
+	{
+		size_t offset, index;
+	};
+	std::string text;
+	std::vector<Piece> pieces; // in order, the first at index 0
+	size_t end_offset, keep;
+
+	size_t index(size_t offset) const;
+};
+
 class Input
 {
 public:
 	static const char32_t END = std::numeric_limits<char32_t>::max();
+	static const size_t WINDOW_SIZE = 64 * 1024;
+	static const size_t LOOKAHEAD = 16; // most code points peek() can see
 
-	Input(std::istream& stream);
+	// Decode from an in-memory range (preferred). When lines is given, the
+	// range's line starts are recorded into it up front.
+	Input(const char *begin, const char *end, LineTable *lines=nullptr);
+	// The same for a range already known to be in encoding, which isn't
+	// detected again (eg. a piece of a larger input)
+	Input(const char *begin, const char *end, Encoding encoding,
+	      LineTable *lines=nullptr);
+	// Decode from a stream that can't be buffered up front (eg. a pipe).
+	// It's read into a fixed-size window a chunk at a time, so memory use
+	// doesn't depend on the length of the stream. Line starts are recorded
+	// into lines as each chunk arrives.
+	//
+	// Either way the encoding is detected from the start of the input (see
+	// detect_encoding()). Anything other than UTF-8 is transcoded to UTF-8
+	// in one go, a stream being read in full for it, and offsets and lines
+	// then refer to the UTF-8 text. Malformed UTF-8 never throws, each bad
+	// sequence decodes as U+FFFD and is recorded in diagnostics.
+	//
+	// When copy is given, the stream's UTF-8 text is appended to it as
+	// it's read, so that offsets can be resolved back to text afterwards.
+	Input(std::istream& stream, LineTable *lines=nullptr,
+	      size_t window_size=WINDOW_SIZE, StreamText *copy=nullptr);
+	// Start over on the buffer [begin, end), as though newly constructed
+	// for it
+	void reset(const char *begin, const char *end, LineTable *lines=nullptr);
+	void reset(const char *begin, const char *end, Encoding encoding,
+	           LineTable *lines=nullptr);
 	char32_t next();
-	char32_t peek();
+	// The k-th code point after last, without consuming anything. Each
+	// code point is decoded once, into a ring that next() then drains.
+	char32_t peek(size_t k=1);
 	bool eof() const;
+	// For in-memory input, the UTF-8 text offsets index into (a transcoded
+	// copy if the input wasn't UTF-8). Meaningless for a stream.
+	const char *data() const { return base; }
 	void skip_whitespace();
+	void skip_line();
+	// Skip until last is the ASCII character a or b, or END
+	void skip_until(char a, char b);
 
-	SourcePosition position;
-	char32_t last;
+	static const size_t NO_TRIVIA = std::numeric_limits<size_t>::max();
 
-	std::istream& input_stream() { return stream; }
+	size_t offset; // byte offset of last
+	// Where the whitespace and comments being skipped started, NO_TRIVIA
+	// when they aren't. They're cut from the copy of a stream as it's
+	// read further.
+	size_t trivia_from;
+	char32_t last;
+	Encoding encoding; // of the original input
+	DiagnosticList diagnostics;
 
 private:
-	std::istream& stream;
-	std::istreambuf_iterator<char> end, iter;
-	bool has_peeked;
-	char32_t peeked;
+	const char *base, *cur, *lim;
+	const char *ascii_lim; // end of the known-ASCII run at cur
+	size_t base_offset;    // offset of base in the whole input
+	std::istream *stream;
+	StreamText *stream_copy;
+	std::unique_ptr<char[]> window;
+	std::unique_ptr<char[]> text; // the input transcoded to UTF-8, if it wasn't
+	size_t window_size;
+	size_t scanned;        // offset up to which lines were recorded
+	bool at_eof;
+	LineTable *lines;
+	char32_t ahead[LOOKAHEAD];     // decoded but not yet consumed
+	size_t ahead_offset[LOOKAHEAD];
+	size_t ahead_head, ahead_count;
+
+	char32_t decode();
+	char32_t read(size_t& at);
+	int peek_byte();
+	size_t consumed() const { return base_offset + (cur - base); }
+	bool refill(size_t done);
+	void scan_lines();
+	void transcode(const char *begin, const char *end);
 };
 
 } // namespace Soda
@@ -0,0 +1,65 @@
+#include <soda/sodainc.h> // pch
+#include <soda/interner.h>
+#include <soda/keywords.h>
+
+namespace Soda
+{
+
+static const unsigned INITIAL_BITS = 10;
+
+Interner::Interner()
+	: slots(size_t(1) << INITIAL_BITS, NO_SYMBOL), shift(32 - INITIAL_BITS)
+{
+}
+
+// The identifier hash is a plain polynomial, the high bits of a
+// multiplicative hash spread it over the table
+inline size_t Interner::slot_of(uint32_t hash) const
+{
+	return uint32_t(hash * 0x9E3779B9u) >> shift;
+}
+
+Symbol Interner::intern(const char32_t *text, size_t len, uint32_t hash)
+{
+	size_t mask = slots.size() - 1;
+	size_t i = slot_of(hash);
+	for (; slots[i] != NO_SYMBOL; i = (i + 1) & mask)
+	{
+		Symbol sym = slots[i];
+		if (hashes[sym] == hash && names[sym].size() == len &&
+		    names[sym].compare(0, len, text, len) == 0)
+			return sym;
+	}
+	Symbol sym = names.size();
+	names.emplace_back(text, len);
+	hashes.push_back(hash);
+	slots[i] = sym;
+	// keep the table at most half full
+	if (names.size() * 2 > slots.size())
+		grow();
+	return sym;
+}
+
+Symbol Interner::intern(const std::u32string& text)
+{
+	uint32_t hash = KEYWORD_HASH_INIT;
+	for (char32_t ch : text)
+		hash = keyword_hash_next(hash, ch);
+	return intern(text.data(), text.size(), hash);
+}
+
+void Interner::grow()
+{
+	slots.assign(slots.size() * 2, NO_SYMBOL);
+	shift--;
+	size_t mask = slots.size() - 1;
+	for (Symbol sym = 0; sym < names.size(); sym++)
+	{
+		size_t i = slot_of(hashes[sym]);
+		while (slots[i] != NO_SYMBOL)
+			i = (i + 1) & mask;
+		slots[i] = sym;
+	}
+}
+
+} // namespace Soda
@@ -0,0 +1,49 @@
+#ifndef SODA_INTERNER_H
+#define SODA_INTERNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace Soda
+{
+
+// Each distinct identifier is given a Symbol once, when it's lexed, and
+// from then on the AST and symbol tables compare and hash Symbols instead
+// of strings.
+typedef uint32_t Symbol;
+
+const Symbol NO_SYMBOL = std::numeric_limits<Symbol>::max();
+
+class Interner
+{
+public:
+	Interner();
+
+	// The Symbol of text, added if it's new. hash is text's hash built
+	// with keyword_hash_next(), which the lexer has already worked out by
+	// the time it has scanned an identifier.
+	Symbol intern(const char32_t *text, size_t len, uint32_t hash);
+	Symbol intern(const std::u32string& text);
+
+	const std::u32string& text(Symbol sym) const { return names[sym]; }
+	size_t size() const { return names.size(); }
+
+private:
+	std::vector<std::u32string> names;
+	std::vector<uint32_t> hashes;
+	std::vector<Symbol> slots; // open addressing, NO_SYMBOL when empty
+	unsigned shift;            // 32 - log2(slots.size())
+
+	size_t slot_of(uint32_t hash) const;
+	void grow();
+
+	Interner(const Interner&);
+	Interner& operator=(const Interner&);
+};
+
+} // namespace Soda
+
+#endif // SODA_INTERNER_H
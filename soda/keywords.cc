@@ -0,0 +1,144 @@
+#include <soda/sodainc.h> // pch
+#include <soda/keywords.h>
+
+namespace Soda
+{
+
+namespace
+{
+
+struct Keyword
+{
+	const char *text;
+	size_t len;
+	Token::Kind kind;
+};
+
+#define KW(text, kind) { text, sizeof(text) - 1, Token::kind }
+constexpr Keyword keywords[] = {
+	KW("if", IF),
+	KW("elif", ELIF),
+	KW("else", ELSE),
+	KW("fun", FUN),
+	KW("var", VAR),
+	KW("struct", STRUCT),
+	KW("enum", ENUM),
+	KW("union", UNION),
+	KW("alias", ALIAS),
+	KW("return", RETURN),
+	KW("import", IMPORT),
+	KW("from", FROM),
+	KW("class", CLASS),
+	KW("switch", SWITCH),
+	KW("case", CASE),
+	KW("default", DEFAULT),
+	KW("break", BREAK),
+	KW("const", CONST),
+	KW("static", STATIC),
+	KW("public", PUBLIC),
+	KW("private", PRIVATE),
+	KW("protected", PROTECTED),
+	KW("internal", INTERNAL),
+	KW("namespace", NAMESPACE),
+	KW("delegate", DELEGATE),
+	KW("CCode", CCODE),
+};
+#undef KW
+
+constexpr size_t NUM_KEYWORDS = sizeof(keywords) / sizeof(keywords[0]);
+
+// Multiplicative hashing into 64 slots, the multiplier was found by
+// searching for one that gives every keyword its own slot
+const unsigned SLOT_BITS = 6;
+const size_t NUM_SLOTS = size_t(1) << SLOT_BITS;
+const uint32_t SLOT_MULTIPLIER = 0x5A702CFB;
+
+constexpr uint32_t slot_of(uint32_t hash)
+{
+	return uint32_t(hash * SLOT_MULTIPLIER) >> (32 - SLOT_BITS);
+}
+
+constexpr uint32_t hash_of(const char *s, size_t len, uint32_t hash=KEYWORD_HASH_INIT)
+{
+	return len == 0 ? hash :
+		hash_of(s + 1, len - 1, keyword_hash_next(hash, char32_t(*s)));
+}
+
+constexpr uint32_t keyword_slot(size_t i)
+{
+	return slot_of(hash_of(keywords[i].text, keywords[i].len));
+}
+
+// The table is only perfect if no two keywords share a slot
+constexpr bool slot_unique(size_t i, size_t j)
+{
+	return j == NUM_KEYWORDS ||
+		(keyword_slot(i) != keyword_slot(j) && slot_unique(i, j + 1));
+}
+
+constexpr bool slots_unique(size_t i=0)
+{
+	return i == NUM_KEYWORDS || (slot_unique(i, i + 1) && slots_unique(i + 1));
+}
+
+static_assert(slots_unique(),
+	"keywords collide in the hash table, pick another SLOT_MULTIPLIER");
+
+// Index into keywords of the keyword in a slot, -1 for none
+constexpr int keyword_in(uint32_t slot, size_t i=0)
+{
+	return i == NUM_KEYWORDS ? -1 :
+		keyword_slot(i) == slot ? int(i) : keyword_in(slot, i + 1);
+}
+
+struct Slot
+{
+	int8_t index;
+	uint32_t hash;
+};
+
+constexpr Slot make_slot(uint32_t slot)
+{
+	return {
+		static_cast<int8_t>(keyword_in(slot)),
+		keyword_in(slot) < 0 ? 0 :
+			hash_of(keywords[keyword_in(slot)].text,
+			        keywords[keyword_in(slot)].len)
+	};
+}
+
+#define SLOT4(n) make_slot(n), make_slot(n + 1), make_slot(n + 2), make_slot(n + 3)
+#define SLOT16(n) SLOT4(n), SLOT4(n + 4), SLOT4(n + 8), SLOT4(n + 12)
+constexpr Slot slots[NUM_SLOTS] = {
+	SLOT16(0), SLOT16(16), SLOT16(32), SLOT16(48),
+};
+#undef SLOT16
+#undef SLOT4
+
+} // anonymous namespace
+
+Token::Kind keyword_kind(const char32_t *text, size_t len, uint32_t hash)
+{
+	const Slot& slot = slots[slot_of(hash)];
+	if (slot.index < 0 || slot.hash != hash)
+		return Token::IDENT;
+	const Keyword& kw = keywords[slot.index];
+	if (kw.len != len)
+		return Token::IDENT;
+	for (size_t i = 0; i < len; i++)
+	{
+		if (text[i] != char32_t(kw.text[i]))
+			return Token::IDENT;
+	}
+	return kw.kind;
+}
+
+Token::Kind keyword_kind(const std::u32string& text)
+{
+	uint32_t hash = KEYWORD_HASH_INIT;
+	for (char32_t ch : text)
+		hash = keyword_hash_next(hash, ch);
+	return keyword_kind(text.data(), text.size(), hash);
+}
+
+} // namespace Soda
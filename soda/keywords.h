@@ -0,0 +1,29 @@
+#ifndef SODA_KEYWORDS_H
+#define SODA_KEYWORDS_H
+
+#include <soda/token.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Soda
+{
+
+// Keywords are found with a perfect hash. The lexer folds each identifier
+// character into the hash as it scans it, so telling a keyword from an
+// identifier then takes one table probe and at most one comparison.
+
+const uint32_t KEYWORD_HASH_INIT = 0;
+
+constexpr uint32_t keyword_hash_next(uint32_t hash, char32_t ch)
+{
+	return hash * 31 + ch;
+}
+
+// The keyword kind of text, or IDENT if it isn't one. hash is text's hash.
+Token::Kind keyword_kind(const char32_t *text, size_t len, uint32_t hash);
+Token::Kind keyword_kind(const std::u32string& text);
+
+} // namespace Soda
+
+#endif // SODA_KEYWORDS_H
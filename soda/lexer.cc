@@ -1,6 +1,13 @@
 #include <soda/sodainc.h> // pch
+#include <soda/keywords.h>
 #include <soda/lexer.h>
+#include <soda/numbers.h>
+#include <soda/operators.h>
 #include <soda/utils.h>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 namespace Soda
@@ -10,20 +17,59 @@ struct Lexer::LexImpl
 {
 
 Token& token;
+StreamText streamed; // what's still held of a stream, for text()
 Input input;
+size_t base; // added to input offsets to form token locations
+bool from_stream;
+bool discarding; // whether text() is only asked about the tokens to come
+Interner *interner; // identifiers are interned into it, when given
+std::u32string ident; // the identifier being scanned
+TriviaList *trivia; // skipped comments are recorded into it, when given
 
-LexImpl(Token& tok, std::istream& stream)
-	: token(tok), input(stream)
+LexImpl(Token& tok, std::istream& stream, LineTable *lines, size_t base,
+        Interner *interner)
+	: token(tok), input(stream, lines, Input::WINDOW_SIZE, &streamed),
+	  base(base), from_stream(true), discarding(false), interner(interner),
+	  trivia(nullptr)
 {
 	input.next(); // prime input.last
 }
 
+LexImpl(Token& tok, const char *begin, const char *end, LineTable *lines,
+        size_t base, Interner *interner)
+	: token(tok), input(begin, end, lines), base(base), from_stream(false),
+	  discarding(false), interner(interner), trivia(nullptr)
+{
+	input.next(); // prime input.last
+}
+
+LexImpl(Token& tok, const char *begin, const char *end, Encoding encoding,
+        size_t base)
+	: token(tok), input(begin, end, encoding), base(base), from_stream(false),
+	  discarding(false), interner(nullptr), trivia(nullptr)
+{
+	input.next(); // prime input.last
+}
+
+// Start over on a buffer, keeping the memory held for the last input
+void reset(const char *begin, const char *end, LineTable *lines,
+           size_t base, Interner *interner)
+{
+	input.reset(begin, end, lines);
+	streamed.clear();
+	this->base = base;
+	from_stream = false;
+	discarding = false;
+	this->interner = interner;
+	trivia = nullptr;
+	token = Token();
+	input.next(); // prime input.last
+}
+
 // Update the current token's start position and clear its text/kind
 void begin_token()
 {
-	token.location.offset.start = input.position.offset;
-	token.location.line.start   = input.position.line;
-	token.location.column.start = input.position.column;
+	token.location = SourceLocation(base + input.offset, base + input.offset);
 	clear();
 }
 
@@ -31,9 +77,7 @@ void begin_token()
 // so doesn't often need to be called explicitly.
 void end_token()
 {
-	token.location.offset.end = input.position.offset;
-	token.location.line.end   = input.position.line;
-	token.location.column.end = input.position.column;
+	token.location.set_end(base + input.offset);
 }
 
 // Clear the current token's text and kind (Note: it's called by begin
@@ -43,8 +87,8 @@ void clear()
 	token.clear();
 }
 
-// verify the current input.last is what we expect and then save it into
-// the token text, update the token end location and finally advance the input.
+// verify the current input.last is what we expect, update the token end
+// location and advance the input.
 void advance(char32_t ch = std::numeric_limits<char32_t>::max())
 {
 #ifndef NDEBUG
@@ -58,96 +102,229 @@ void advance(char32_t ch = std::numeric_limits<char32_t>::max())
 		std::terminate();
 	}
 #endif
-	token.text += input.last;
 	input.next();
 	end_token();
 }
 
+void add_trivia(Trivia::Kind kind, size_t start)
+{
+	if (trivia)
+	{
+		Trivia t = { SourceLocation(base + start, base + input.offset), kind };
+		trivia->push_back(t);
+	}
+}
+
+// "//"[^\n]*
+void skip_line_comment()
+{
+	size_t start = input.offset;
+	input.next();
+	input.next();
+	input.skip_line();
+	add_trivia(Trivia::LINE_COMMENT, start);
+	if (input.last != Input::END)
+		input.next(); // skip the newline
+}
+
+// "/*".*?"*/"
+void skip_block_comment()
+{
+	size_t start = input.offset;
+	input.next();
+	input.next();
+	for (;;)
+	{
+		input.skip_until('*', '*');
+		if (input.last == Input::END)
+			break;
+		if (input.next() == '/')
+		{
+			input.next(); // skip the trailing */
+			break;
+		}
+	}
+	add_trivia(Trivia::BLOCK_COMMENT, start);
+}
+
+// The body of a string or char literal, up to the closing quote or END.
+// A backslash escapes whatever follows it; what the escapes mean is left
+// to literal().
+void skip_quoted(char quote)
+{
+	input.skip_until(quote, '\\');
+	while (input.last == '\\')
+	{
+		if (input.next() != Input::END)
+			input.next(); // the escaped character
+		input.skip_until(quote, '\\');
+	}
+	end_token();
+}
+
+// The digits of a 0x, 0b or 0o integer, shift bits each
+void scan_digits(NumberValue& num, unsigned shift,
+                 bool (*is_base_digit)(char32_t))
+{
+	if (!is_base_digit(input.last))
+		num.status = NumberValue::MALFORMED;
+	while (is_base_digit(input.last))
+	{
+		char32_t ch = input.last;
+		unsigned digit = (ch <= '9') ? ch - '0' : (ch | 0x20) - 'a' + 10;
+		if (num.integer >> (64 - shift))
+			num.status = NumberValue::OUT_OF_RANGE;
+		num.integer = num.integer << shift | digit;
+		advance(ch);
+	}
+}
+
+// The rest of a decimal integer or float, whose first character has been
+// consumed. A float is gathered as its first 19 significant digits and a
+// power of ten.
+Token::Kind scan_decimal(NumberValue& num, char32_t first)
+{
+	const uint64_t max = std::numeric_limits<uint64_t>::max();
+	uint64_t integer = 0, w = 0;
+	int digits = 0, exp10 = 0, dots = 0;
+	bool truncated = false;
+	char32_t ch = first;
+	for (;;)
+	{
+		if (ch == '.')
+			dots++;
+		else
+		{
+			unsigned digit = ch - '0';
+			if (integer > max / 10 ||
+			    (integer == max / 10 && digit > max % 10))
+				num.status = NumberValue::OUT_OF_RANGE;
+			integer = integer * 10 + digit;
+			if (w == 0 && digit == 0)
+				exp10 -= (dots != 0);
+			else if (digits < 19)
+			{
+				w = w * 10 + digit;
+				digits++;
+				exp10 -= (dots != 0);
+			}
+			else
+			{
+				exp10 += (dots == 0);
+				truncated |= (digit != 0);
+			}
+		}
+		if (!is_digit(input.last) && input.last != '.')
+			break;
+		ch = input.last;
+		advance(ch);
+	}
+
+	if (dots == 0)
+	{
+		num.integer = integer;
+		return Token::DEC_ICONST;
+	}
+	num.status = NumberValue::VALID;
+	if (dots > 1)
+	{
+		num.status = NumberValue::MALFORMED;
+		return Token::FCONST;
+	}
+	// Cut short, the digits dropped could only round it up to what w + 1
+	// gives. If they disagree, or it's beyond the fast method, strtod()
+	// has the last word.
+	double value, above;
+	if (decimal_to_double(w, exp10, value) &&
+	    (!truncated || (decimal_to_double(w + 1, exp10, above) &&
+	                    value == above)))
+		num.real = value;
+	else
+	{
+		const char *text = bytes(token.location.start());
+		num.real = std::strtod(
+			std::string(text, token.location.length).c_str(), nullptr);
+	}
+	if (std::isinf(num.real))
+		num.status = NumberValue::OUT_OF_RANGE;
+	return Token::FCONST;
+}
+
+// The UTF-8 text at a token location, for in-memory input or what's been
+// read of a stream
+const char *bytes(size_t location) const
+{
+	if (!from_stream)
+		return input.data() + (location - base);
+	return streamed.at(location - base);
+}
+
+void discard(size_t location)
+{
+	if (!from_stream)
+		return;
+	discarding = true;
+	streamed.keep_from(location - base);
+}
+
 // The big-fat tokenizing routine
 Token::Kind next()
 {
 	clear();
 
-// Whitespace
-	while (Soda::is_whitespace(input.last))
-		input.next();
+// Whitespace and comments, in a loop so that a long run of comments
+// doesn't recurse. Once the tokens before are all text() is asked about,
+// they needn't be kept from a stream.
+	if (discarding)
+		input.trivia_from = input.offset;
+	for (;;)
+	{
+		input.skip_whitespace();
+		if (input.last != '/')
+			break;
+		char32_t second = input.peek();
+		if (second == '/')
+			skip_line_comment();
+		else if (second == '*')
+			skip_block_comment();
+		else
+			break;
+	}
+	input.trivia_from = Input::NO_TRIVIA;
 
-// Identifiers: [a-zA-Z_][a-zA-Z_0-9]*
-	if (is_alpha(input.last) || input.last == '_')
+// Identifiers: [_\p{XID_Start}][\p{XID_Continue}]*
+	if (is_ident_start(input.last))
 	{
 		begin_token();
-		advance(input.last);
-		while (is_alnum(input.last) || input.last == '_')
+		uint32_t hash = KEYWORD_HASH_INIT;
+		ident.clear();
+		do
+		{
+			hash = keyword_hash_next(hash, input.last);
+			ident += input.last;
 			advance(input.last);
-		if (token.text == U"if")
-			token.kind = Token::IF;
-		else if (token.text == U"elif")
-			token.kind = Token::ELIF;
-		else if (token.text == U"else")
-			token.kind = Token::ELSE;
-		else if (token.text == U"fun")
-			token.kind = Token::FUN;
-		else if (token.text == U"var")
-			token.kind = Token::VAR;
-		else if (token.text == U"struct")
-			token.kind = Token::STRUCT;
-		else if (token.text == U"enum")
-			token.kind = Token::ENUM;
-		else if (token.text == U"union")
-			token.kind = Token::UNION;
-		else if (token.text == U"alias")
-			token.kind = Token::ALIAS;
-		else if (token.text == U"return")
-			token.kind = Token::RETURN;
-		else if (token.text == U"import")
-			token.kind = Token::IMPORT;
-		else if (token.text == U"from")
-			token.kind = Token::FROM;
-		else if (token.text == U"class")
-			token.kind = Token::CLASS;
-		else if (token.text == U"switch")
-			token.kind = Token::SWITCH;
-		else if (token.text == U"case")
-			token.kind = Token::CASE;
-		else if (token.text == U"default")
-			token.kind = Token::DEFAULT;
-		else if (token.text == U"break")
-			token.kind = Token::BREAK;
-		else if (token.text == U"const")
-			token.kind = Token::CONST;
-		else if (token.text == U"static")
-			token.kind = Token::STATIC;
-		else if (token.text == U"public")
-			token.kind = Token::PUBLIC;
-		else if (token.text == U"private")
-			token.kind = Token::PRIVATE;
-		else if (token.text == U"protected")
-			token.kind = Token::PROTECTED;
-		else if (token.text == U"internal")
-			token.kind = Token::INTERNAL;
-		else if (token.text == U"namespace")
-			token.kind = Token::NAMESPACE;
-		else if (token.text == U"delegate")
-			token.kind = Token::DELEGATE;
-		else if (token.text == U"CCode")
-			token.kind = Token::CCODE;
-		else
-			token.kind = Token::IDENT;
+		}
+		while (is_ident_continue(input.last));
+		token.kind = keyword_kind(ident.data(), ident.size(), hash);
+		if (token.kind == Token::IDENT && interner)
+			token.symbol = interner->intern(ident.data(), ident.size(), hash);
 	}
 // Numbers
 	else if (is_digit(input.last) ||
 	         (input.last == '.' && is_digit(input.peek())))
 	{
-		bool found_dot = (input.last == '.');
+		char32_t first = input.last;
 		begin_token();
 		advance(input.last);
+		NumberValue num;
+		num.integer = 0;
+		num.status = NumberValue::VALID;
 // 0[xX][a-fA-F0-9]*
 		if (input.last == 'x' || input.last == 'X')
 		{
 			advance(input.last);
 			begin_token(); // skip over the 0x prefix
-			while (is_hex(input.last))
-				advance(input.last);
+			scan_digits(num, 4, is_hex);
 			token.kind = Token::HEX_ICONST;
 		}
 // 0[bB][0-1]*
@@ -155,8 +332,7 @@ Token::Kind next()
 		{
 			advance(input.last);
 			begin_token(); // skip over the 0b prefix
-			while (is_binary(input.last))
-				advance(input.last);
+			scan_digits(num, 1, is_binary);
 			token.kind = Token::BIN_ICONST;
 		}
 // 0[oO][0-7]*
@@ -164,44 +340,20 @@ Token::Kind next()
 		{
 			advance(input.last);
 			begin_token(); // skip over the 0o prefix
-			while (is_octal(input.last))
-				advance(input.last);
+			scan_digits(num, 3, is_octal);
 			token.kind = Token::OCT_ICONST;
 		}
 // ([0-9]+|([0-9]*\.[0-9]+|[0-9]+\.[0-9]*))
 		else
-		{
-			while (is_digit(input.last) || input.last == '.')
-			{
-				if (input.last == '.')
-				{
-					if (!found_dot)
-						found_dot = true;
-					// else ERROR
-				}
-				advance(input.last);
-			}
-			if (found_dot)
-				token.kind = Token::FCONST;
-			else
-				token.kind = Token::DEC_ICONST;
-		}
+			token.kind = scan_decimal(num, first);
+		token.set_number(num);
 	}
-// Char Literal: "'"[^']+"'"
+// Char Literal: "'"([^'\\]|\\.)*"'"
 	else if (input.last == '\'')
 	{
 		advance('\'');
 		begin_token(); // skip the '
-		while (input.last != '\'' && input.last != Input::END)
-		{
-			if (input.last == '\\' && input.peek() == '\'')
-			{
-				advance('\\');
-				advance('\'');
-			}
-			else
-				advance(input.last);
-		}
+		skip_quoted('\'');
 		if (input.last != Input::END)
 		{
 			input.next(); // skip the trailing '
@@ -210,21 +362,12 @@ Token::Kind next()
 		else
 			token.kind = Token::ERROR;
 	}
-// String Literal: "\""[^"]*"\""
+// String Literal: "\""([^"\\]|\\.)*"\""
 	else if (input.last == '"')
 	{
 		advance('"');
 		begin_token(); // skip the "
-		while (input.last != '"' && input.last != Input::END)
-		{
-			if (input.last == '\\' && input.peek() == '"')
-			{
-				advance('\\');
-				advance('\"');
-			}
-			else
-				advance(input.last);
-		}
+		skip_quoted('"');
 		if (input.last != Input::END)
 		{
 			input.next(); // skip the trailing "
@@ -233,305 +376,36 @@ Token::Kind next()
 		else
 			token.kind = Token::ERROR;
 	}
-// (">>="|">>"|">="|">")
-	else if (input.last == '>')
-	{
-		begin_token();
-		advance('>');
-		if (input.last == '>')
-		{
-			advance('>');
-// ">>="
-			if (input.last == '=')
-			{
-				advance('=');
-				token.kind = Token::RSHIFT_ASSIGN;
-			}
-// ">>"
-			else
-				token.kind = Token::RSHIFT;
-		}
-// ">="
-		else if (input.last == '=')
-		{
-			advance('=');
-			token.kind = Token::GE_OP;
-		}
-// ">"
-		else
-			token.kind = Token::GT;
-	}
-// ("<<="|"<<"|"<="|"<")
-	else if (input.last == '<')
-	{
-		begin_token();
-		advance('<');
-		if (input.last == '<')
-		{
-			advance('<');
-// "<<="
-			if (input.last == '=')
-			{
-				advance('=');
-				token.kind = Token::LSHIFT_ASSIGN;
-			}
-// "<<"
-			else // <<
-				token.kind = Token::LSHIFT;
-		}
-// "<="
-		else if (input.last == '=')
-		{
-			advance('=');
-			token.kind = Token::LE_OP;
-		}
-// "<"
-		else // <
-			token.kind = Token::LT;
-	}
-// ("+="|"++"|"+")
-	else if (input.last == '+')
-	{
-		begin_token();
-		advance('+');
-// "+="
-		if (input.last == '=')
-		{
-			advance('=');
-			token.kind = Token::ADD_ASSIGN;
-		}
-// "++"
-		else if (input.last == '+')
-		{
-			advance('+');
-			token.kind = Token::INC_OP;
-		}
-// "+"
-		else
-			token.kind = Token::PLUS;
-	}
-// ("-="|"--"|"->"|"-")
-	else if (input.last == '-')
-	{
-		begin_token();
-		advance('-');
-// "-="
-		if (input.last == '=')
-		{
-			advance('=');
-			token.kind = Token::SUB_ASSIGN;
-		}
-// "--"
-		else if (input.last == '-')
-		{
-			advance('-');
-			token.kind = Token::DEC_OP;
-		}
-// "->"
-		else if (input.last == '>')
-		{
-			advance('>');
-			token.kind = Token::PTR_OP;
-		}
-// "-"
-		else
-			token.kind = Token::MINUS;
-	}
-// ("*="|"*")
-	else if (input.last == '*')
-	{
-		begin_token();
-		advance('*');
-// "*="
-		if (input.last == '=')
-		{
-			advance('=');
-			token.kind = Token::MUL_ASSIGN;
-		}
-// "*"
-		else
-			token.kind = Token::MULTIPLY;
-	}
-// ("/="|"/"|"//"[^\n]*|"/*".*?"*/")
-	else if (input.last == '/')
-	{
-		begin_token();
-		advance('/');
-// "/="
-		if (input.last == '=')
-		{
-			advance('=');
-			token.kind = Token::DIV_ASSIGN;
-		}
-// "//"[^\n]*
-		else if (input.last == '/') // // single comment
-		{
-			advance('/');
-			while (!is_newline(input.last) && input.last != Input::END)
-				advance();
-			if (input.last != Input::END)
-			{
-				input.next(); // skip the newline
-				token.kind = Token::COMMENT;
-			}
-			else
-				token.kind = Token::END;
-#if 1
-			token.kind = next();
-#endif
-		}
-// "/*".*?"*/"
-		else if (input.last == '*') // /* multi-comment
-		{
-			advance('*');
-			while (input.last != '*' && input.peek() != '/' && input.last != Input::END)
-				advance();
-			if (input.last != Input::END)
-			{
-				input.next(); input.next(); // skip the trailing */
-				token.kind = Token::COMMENT;
-			}
-			else
-				token.kind = Token::ERROR;
-#if 1
-			token.kind = next();
-#endif
-		}
-// "/"
-		else // /
-			token.kind = Token::DIVIDE;
-	}
-// ("%="|"%")
-	else if (input.last == '%')
-	{
-		begin_token();
-		advance('%');
-// "%="
-		if (input.last == '=')
-		{
-			advance('=');
-			token.kind = Token::MOD_ASSIGN;
-		}
-// "%"
-		else
-			token.kind = Token::MODULO;
-	}
-// ("&="|"&&"|"&")
-	else if (input.last == '&')
-	{
-		begin_token();
-		advance('&');
-// "&="
-		if (input.last == '=')
-		{
-			advance('=');
-			token.kind = Token::AND_ASSIGN;
-		}
-// "&&"
-		else if (input.last == '&')
-		{
-			advance('&');
-			token.kind = Token::LOG_AND;
-		}
-// "&"
-		else
-			token.kind = Token::BOOL_AND;
-	}
-// ("^="|"^")
-	else if (input.last == '^')
+// Operators and punctuation, the longest match found by walking the DFA
+	else if (is_operator_start(input.last))
 	{
 		begin_token();
-		advance('^');
-// "^="
-		if (input.last == '=')
+		unsigned state = 0, next_state;
+		while (input.last < 0x80 &&
+		       (next_state = operator_dfa[state][input.last]) != 0)
 		{
-			advance('=');
-			token.kind = Token::XOR_ASSIGN;
+			state = next_state;
+			advance();
 		}
-// "^"
-		else
-			token.kind = Token::BOOL_XOR;
-	}
-// ("|="|"||"|"|")
-	else if (input.last == '|')
-	{
-		begin_token();
-		advance('|');
-// "|="
-		if (input.last == '=')
-		{
-			advance('=');
-			token.kind = Token::OR_ASSIGN;
-		}
-// "||"
-		else if (input.last == '|')
-		{
-			advance('|');
-			token.kind = Token::LOG_OR;
-		}
-// "|"
-		else
-			token.kind = Token::BOOL_OR;
-	}
-// ("!="|"!")
-	else if (input.last == '!')
-	{
-		begin_token();
-		advance('!');
-		if (input.last == '=')
-		{
-			advance('=');
-			token.kind = Token::NE_OP;
-		}
-		else
-			token.kind = Token::NOT;
-	}
-// ("=="|"=")
-	else if (input.last == '=')
-	{
-		begin_token();
-		advance('=');
-// "=="
-		if (input.last == '=')
-		{
-			advance('=');
-			token.kind = Token::EQ_OP;
-		}
-// "="
-		else
-			token.kind = Token::EQ;
+		token.kind = operator_kinds[state];
 	}
 
-// Single characters
-
-#define MATCH_SINGLE(ch, tok_kind)    \
-	else if (input.last == ch) {      \
-		begin_token(); advance(ch);   \
-		token.kind = Token::tok_kind; \
-	}
-
-	MATCH_SINGLE('.', DOT)
-	MATCH_SINGLE('~', TILDE)
-	MATCH_SINGLE('?', QUESTION)
-	MATCH_SINGLE(':', COLON)
-	MATCH_SINGLE(';', SEMICOLON)
-	MATCH_SINGLE(',', COMMA)
-	MATCH_SINGLE('(', LPAREN)
-	MATCH_SINGLE(')', RPAREN)
-	MATCH_SINGLE('[', LBRACKET)
-	MATCH_SINGLE(']', RBRACKET)
-	MATCH_SINGLE('{', LBRACE)
-	MATCH_SINGLE('}', RBRACE)
-
-#undef MATCH_SINGLE
-
 // EOF or unmatched input
 	if (token.kind == Token::ZERO)
 	{
 		if (input.last == Input::END) // EOF
+		{
+			begin_token(); // locate END at the end of the input
+			token.kind = Token::END;
 			return Token::END;
-		else // unmatched input
+		}
+		else // unmatched input, consumed so lexing can carry on past it
+		{
+			begin_token();
+			advance();
+			token.kind = Token::ERROR;
 			return Token::ERROR;
+		}
 	}
 
 	return token.kind;
@@ -539,11 +413,35 @@ Token::Kind next()
 
 }; // LexerImpl
 
-Lexer::Lexer(std::istream& stream)
-	: token(), impl(new LexImpl(token, stream))
+Lexer::Lexer(std::istream& stream, LineTable *lines, size_t base,
+             Interner *interner)
+	: token(), impl(new LexImpl(token, stream, lines, base, interner))
 {
 }
 
+Lexer::Lexer(const char *begin, const char *end, LineTable *lines,
+             size_t base, Interner *interner)
+	: token(), impl(new LexImpl(token, begin, end, lines, base, interner))
+{
+}
+
+Lexer::Lexer(const char *begin, const char *end, Encoding encoding,
+             size_t base)
+	: token(), impl(new LexImpl(token, begin, end, encoding, base))
+{
+}
+
+Lexer::Lexer()
+	: token(), impl(new LexImpl(token, nullptr, nullptr, ENC_UTF8, 0))
+{
+}
+
+void Lexer::reset(const char *begin, const char *end, LineTable *lines,
+                  size_t base, Interner *interner)
+{
+	impl->reset(begin, end, lines, base, interner);
+}
+
 Lexer::~Lexer()
 {
 	delete impl;
@@ -554,14 +452,174 @@ Token::Kind Lexer::next()
 	return impl->next();
 }
 
-TokenList tokenize(std::istream& stream)
+void Lexer::keep_trivia(TriviaList *trivia)
+{
+	impl->trivia = trivia;
+}
+
+void Lexer::discard(size_t location)
+{
+	impl->discard(location);
+}
+
+size_t Lexer::held() const
+{
+	return impl->streamed.held();
+}
+
+size_t Lexer::offset() const
+{
+	return impl->base + impl->input.offset;
+}
+
+Encoding Lexer::encoding() const
+{
+	return impl->input.encoding;
+}
+
+DiagnosticList& Lexer::diagnostics()
+{
+	return impl->input.diagnostics;
+}
+
+std::u32string Lexer::text(const Token& tok) const
+{
+	const char *start = impl->bytes(tok.location.start());
+	return utf8_decode(start, start + tok.location.length);
+}
+
+// The code point in the digits hex digits at p, for \x, \u and \U
+static bool hex_escape(const char *&p, const char *end, int digits,
+                       char32_t& cp)
+{
+	if (end - p < digits)
+		return false;
+	cp = 0;
+	for (int i = 0; i < digits; i++, p++)
+	{
+		char32_t ch = static_cast<unsigned char>(*p);
+		if (!is_hex(ch))
+			return false;
+		cp = cp << 4 | ((ch <= '9') ? ch - '0' : (ch | 0x20) - 'a' + 10);
+	}
+	return cp < 0xD800 || (cp > 0xDFFF && cp <= 0x10FFFF);
+}
+
+bool Lexer::literal(const Token& tok, std::u32string& out) const
+{
+	const char *p = impl->bytes(tok.location.start());
+	const char *end = p + tok.location.length;
+	while (p < end)
+	{
+		// the text up to the next escape is taken as it is
+		const char *esc = static_cast<const char*>(
+			std::memchr(p, '\\', end - p));
+		if (!esc)
+			esc = end;
+		utf8_decode(p, esc, out);
+		if (esc == end)
+			break;
+		p = esc + 1;
+		if (p == end)
+			return false;
+		char32_t cp;
+		switch (*p++)
+		{
+			case '\\': cp = '\\'; break;
+			case '"':  cp = '"';  break;
+			case '\'': cp = '\''; break;
+			case '0':  cp = '\0'; break;
+			case 'a':  cp = '\a'; break;
+			case 'b':  cp = '\b'; break;
+			case 'f':  cp = '\f'; break;
+			case 'n':  cp = '\n'; break;
+			case 'r':  cp = '\r'; break;
+			case 't':  cp = '\t'; break;
+			case 'v':  cp = '\v'; break;
+			case 'x':
+				if (!hex_escape(p, end, 2, cp))
+					return false;
+				break;
+			case 'u':
+				if (!hex_escape(p, end, 4, cp))
+					return false;
+				break;
+			case 'U':
+				if (!hex_escape(p, end, 8, cp))
+					return false;
+				break;
+			default:
+				return false;
+		}
+		out += cp;
+	}
+	return true;
+}
+
+void Lexer::finish(SourceFile& file)
+{
+	DiagnosticList& found = impl->input.diagnostics;
+	if (file.diagnostics.empty())
+		file.diagnostics.swap(found);
+	else
+		file.diagnostics.insert(file.diagnostics.end(), found.begin(),
+		                        found.end());
+	if (impl->from_stream)
+	{
+		file.encoding = impl->input.encoding;
+		file.size = impl->streamed.end();
+		if (impl->streamed.whole())
+			file.buffer.reset(new SourceBuffer(impl->streamed.take()));
+	}
+}
+
+static TokenList tokenize(Lexer& lex)
 {
 	TokenList tokens;
-	Lexer lex(stream);
 	Token::Kind kind;
 	while ((kind = lex.next()) != Token::END)
 		tokens.push_back(std::move(lex.token));
-	return std::move(tokens);
+	return tokens;
+}
+
+TokenList tokenize(std::istream& stream, LineTable *lines)
+{
+	// nothing can ask for the text afterwards, so none of it is kept
+	Lexer lex(stream, lines);
+	TokenList tokens;
+	for (;;)
+	{
+		lex.discard(lex.offset());
+		if (lex.next() == Token::END)
+			return tokens;
+		tokens.push_back(lex.token);
+	}
+}
+
+TokenList tokenize(const char *begin, const char *end, LineTable *lines,
+                   TriviaList *trivia)
+{
+	Lexer lex(begin, end, lines);
+	lex.keep_trivia(trivia);
+	return tokenize(lex);
+}
+
+TokenList tokenize(SourceFile& file, Interner *interner)
+{
+	Lexer lex(file.buffer->begin(), file.buffer->end(), nullptr, file.base,
+	          interner);
+	TokenList tokens(tokenize(lex));
+	lex.finish(file);
+	return tokens;
+}
+
+TokenList tokenize(SourceFile& file, std::istream& stream,
+                   Interner *interner)
+{
+	Lexer lex(stream, &file.lines, file.base, interner);
+	TokenList tokens(tokenize(lex));
+	lex.finish(file);
+	return tokens;
 }
 
 } // namespace Soda
@@ -2,8 +2,11 @@
 #define SODA_LEXER_H
 
 #include <soda/input.h>
-#include <soda/token.h>
+#include <soda/interner.h>
+#include <soda/sourcemanager.h>
+#include <soda/tokenlist.h>
 #include <istream>
+#include <string>
 
 namespace Soda
 {
@@ -12,9 +15,51 @@ class Lexer
 {
 public:
 	Token token;
-	Lexer(std::istream& stream);
+	// Line starts are recorded into lines, when given, and base is added
+	// to every token location. With an interner, IDENT tokens get their
+	// symbol from it.
+	Lexer(std::istream& stream, LineTable *lines=nullptr, size_t base=0,
+	      Interner *interner=nullptr);
+	Lexer(const char *begin, const char *end, LineTable *lines=nullptr,
+	      size_t base=0, Interner *interner=nullptr);
+	// Lex a range already known to be in encoding, without detecting it
+	// (see Input)
+	Lexer(const char *begin, const char *end, Encoding encoding,
+	      size_t base=0);
+	// An empty input, for reset() to replace
+	Lexer();
+	// Start over on a buffer as the constructor above would, reusing the
+	// memory the last input needed
+	void reset(const char *begin, const char *end, LineTable *lines=nullptr,
+	           size_t base=0, Interner *interner=nullptr);
 	~Lexer();
 	Token::Kind next();
+	// Where the next token will be lexed from (past the last one and any
+	// closing quote), base included
+	size_t offset() const;
+	// Record the comments skipped from now on into trivia, or stop with
+	// nullptr. Comments are dropped by default.
+	void keep_trivia(TriviaList *trivia);
+	// The detected encoding of the input
+	Encoding encoding() const;
+	// Problems found in the input so far, with input-relative offsets
+	DiagnosticList& diagnostics();
+	// The text of a token from this lexer, decoded from the input
+	std::u32string text(const Token& tok) const;
+	// Append the value of a STR_LIT or CHAR_ICONST token from this lexer
+	// to out, with its escapes decoded. False if one is malformed.
+	bool literal(const Token& tok, std::u32string& out) const;
+	// Let go of the text of a stream before location, which text() and
+	// literal() won't be asked about again, along with the whitespace and
+	// comments from then on. A stream lexer otherwise keeps everything it
+	// has read, so that they work for any of its tokens.
+	void discard(size_t location);
+	// How many bytes of a stream's text are held for text() and literal()
+	size_t held() const;
+	// Hand what's been lexed of file over to it: the diagnostics and, for
+	// a stream, its size, encoding and the text read if none of it was
+	// discarded (text() can't use it afterwards)
+	void finish(SourceFile& file);
 private:
 	struct LexImpl;
 	LexImpl *impl;
@@ -22,7 +67,17 @@ private:
 	Lexer& operator=(const Lexer&);
 };
 
-TokenList tokenize(std::istream& stream);
+// Token locations are offsets into the input, once it's in UTF-8
+TokenList tokenize(std::istream& stream, LineTable *lines=nullptr);
+TokenList tokenize(const char *begin, const char *end,
+                   LineTable *lines=nullptr, TriviaList *trivia=nullptr);
+
+// Lex a file registered with a SourceManager, locations include its base
+// and diagnostics are added to the file's. A streamed file keeps what was
+// read as its buffer, so SourceManager::text() works for either.
+TokenList tokenize(SourceFile& file, Interner *interner=nullptr);
+TokenList tokenize(SourceFile& file, std::istream& stream,
+                   Interner *interner=nullptr);
 
 } // namespace Soda
 
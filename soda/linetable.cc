@@ -0,0 +1,58 @@
+#include <soda/sodainc.h> // pch
+#include <soda/linetable.h>
+#include <soda/scan.h>
+#include <algorithm>
+
+namespace Soda
+{
+
+LineTable::LineTable()
+	: starts(1, 0), cr_end(NO_CR)
+{
+}
+
+void LineTable::clear()
+{
+	starts.assign(1, 0);
+	cr_end = NO_CR;
+}
+
+void LineTable::add_line(size_t offset)
+{
+	starts.push_back(offset);
+}
+
+void LineTable::scan(const char *begin, const char *end, size_t base)
+{
+	const char *p = begin;
+	while ((p = find_line_break(p, end)) != end)
+	{
+		size_t offset = base + (p - begin);
+		unsigned char ch = *p++;
+		if (ch == '\n' && offset == cr_end)
+			starts.back() = offset + 1; // LF of a CR LF pair
+		else if (ch >= '\n' && ch <= '\r')
+		{
+			starts.push_back(offset + 1);
+			if (ch == '\r')
+				cr_end = offset + 1;
+		}
+		else if (ch == 0xC2 && p < end &&
+		         static_cast<unsigned char>(*p) == 0x85) // Next Line
+			starts.push_back(offset + 2);
+		else if (ch == 0xE2 && end - p >= 2 &&
+		         static_cast<unsigned char>(p[0]) == 0x80 &&
+		         (static_cast<unsigned char>(p[1]) == 0xA8 ||
+		          static_cast<unsigned char>(p[1]) == 0xA9)) // LS, PS
+			starts.push_back(offset + 3);
+	}
+}
+
+SourcePosition LineTable::position(size_t offset) const
+{
+	auto it = std::upper_bound(starts.begin(), starts.end(), offset);
+	size_t line = (it - starts.begin()) - 1;
+	return SourcePosition(offset, line, offset - starts[line]);
+}
+
+} // namespace Soda
@@ -0,0 +1,41 @@
+#ifndef SODA_LINETABLE_H
+#define SODA_LINETABLE_H
+
+#include <soda/sourcelocation.h>
+#include <cstddef>
+#include <vector>
+
+namespace Soda
+{
+
+// Byte offsets of the start of each line in a source file, used to turn
+// offsets into line/column pairs on demand. Recognizes the same line
+// breaks as is_newline(), with CR LF counted as one.
+class LineTable
+{
+public:
+	LineTable();
+
+	// Record the line starts in [begin, end), which sits at offset base
+	// in the file. Ranges must be added in order, and a multibyte line
+	// break mustn't be split across two ranges.
+	void scan(const char *begin, const char *end, size_t base=0);
+	// Record a single line starting at offset, for inputs that aren't
+	// scanned a range at a time.
+	void add_line(size_t offset);
+	void clear();
+
+	size_t lines() const { return starts.size(); }
+	// The line of offset, with its column in bytes (SourceManager counts
+	// it in code points)
+	SourcePosition position(size_t offset) const;
+
+private:
+	static const size_t NO_CR = static_cast<size_t>(-1);
+	std::vector<size_t> starts;
+	size_t cr_end; // offset just past the last CR seen, for CR LF
+};
+
+} // namespace Soda
+
+#endif // SODA_LINETABLE_H
@@ -1,7 +1,7 @@
 #include <soda/sodainc.h> // pch
 #include <soda/parser.h>
 #include <soda/debugvisitor.h>
-#include <fstream>
+#include <soda/fileloader.h>
 
 using namespace Soda;
 
@@ -16,8 +16,63 @@ void print_help()
 	             "  -V, --version  Show version information\n\n";
 }
 
+// Warnings about the input, such as malformed UTF-8. A corrupt file can
+// have one every few bytes so only the first few per file are shown.
+void print_diagnostics(const TU& tu)
+{
+	const size_t max_per_file = 20;
+	for (size_t i = 0; i < tu.sources.files(); i++)
+	{
+		const SourceFile& file = tu.sources.file_at(i);
+		size_t n = std::min(file.diagnostics.size(), max_per_file);
+		for (size_t j = 0; j < n; j++)
+			format_diagnostic(std::cerr, file, file.diagnostics[j]);
+		if (file.diagnostics.size() > n)
+			std::cerr << "warning: " << file.name << ": "
+			          << (file.diagnostics.size() - n)
+			          << " more warnings not shown\n";
+	}
+}
+
+// Parse and dump one source file, returns false if it couldn't be
+// compiled. Files other than stdin come from loader.
+bool compile(const std::string& fn, FileLoader& loader, size_t index)
+{
+	TU tu(fn);
+	try
+	{
+		if (tu.fn == "-")
+		{
+			tu.fn = "<stdin>";
+			parse(tu, std::cin);
+		}
+		else
+		{
+			std::unique_ptr<SourceBuffer> buf = loader.take(index);
+			if (!buf)
+			{
+				std::cerr << "error: failed to open input file '"
+						  << tu.fn << "'" << std::endl;
+				return false;
+			}
+			parse(tu, tu.sources.add_file(tu.fn, std::move(buf)));
+		}
+		print_diagnostics(tu);
+		DebugVisitor visitor(std::cout);
+		tu.accept(visitor);
+		return true;
+	}
+	catch (SyntaxError& err)
+	{
+		print_diagnostics(tu);
+		format_exception(std::cerr, err);
+		return false;
+	}
+}
+
 int main(int argc, char *argv[])
 {
+	std::vector<std::string> sources, files;
 	for (int i=1; i < argc; i++)
 	{
 		std::string arg(argv[i]);
@@ -33,35 +88,24 @@ int main(int argc, char *argv[])
 		}
 		else
 		{
-			try
-			{
-				TU tu(argv[i]);
-				if (tu.fn == "-")
-				{
-					tu.fn = "<stdin>";
-					parse(tu, std::cin);
-				}
-				else
-				{
-					std::ifstream f(tu.fn);
-					if (!f.is_open())
-					{
-						std::cerr << "error: failed to open input file '"
-								  << tu.fn << "'" << std::endl;
-						return 0;
-					}
-					parse(tu);
-				}
-				DebugVisitor visitor(std::cout);
-				tu.accept(visitor);
-				return 0;
-			}
-			catch (SyntaxError& err)
-			{
-				format_exception(std::cerr, err);
-				return 1;
-			}
+			sources.push_back(arg);
+			if (arg != "-")
+				files.push_back(arg);
 		}
 	}
-	return 1;
+	if (sources.empty())
+		return 1;
+
+	// start reading every file now, each is parsed as soon as it arrives
+	FileLoader loader(files);
+	size_t next_file = 0;
+	bool ok = true;
+	for (auto& fn : sources)
+	{
+		if (!compile(fn, loader, next_file))
+			ok = false;
+		if (fn != "-")
+			next_file++;
+	}
+	return ok ? 0 : 1;
 }
@@ -0,0 +1,19 @@
+#ifndef SODA_NUMBERS_H
+#define SODA_NUMBERS_H
+
+#include <cstdint>
+
+namespace Soda
+{
+
+// The double nearest w * 10^exp10, correctly rounded, by the Eisel-Lemire
+// method: one or two 64x128-bit multiplications by a table of truncated
+// powers of five. w must be exact (at most 19 digits, not cut short).
+// Returns false, leaving value alone, if it can't be sure of the rounding
+// or the exponent is off the end of the table, so the caller can fall back
+// to strtod().
+bool decimal_to_double(uint64_t w, int exp10, double& value);
+
+} // namespace Soda
+
+#endif // SODA_NUMBERS_H
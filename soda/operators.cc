@@ -0,0 +1,132 @@
+#include <soda/sodainc.h> // pch
+#include <soda/operators.h>
+
+namespace Soda
+{
+
+namespace
+{
+
+struct Operator
+{
+	const char *text;
+	size_t len;
+	Token::Kind kind;
+};
+
+#define OP(text, kind) { text, sizeof(text) - 1, Token::kind }
+constexpr Operator operators[] = {
+	OP("<", LT), OP(">", GT), OP("=", EQ), OP("+", PLUS), OP("-", MINUS),
+	OP("*", MULTIPLY), OP("/", DIVIDE), OP("%", MODULO), OP("&", BOOL_AND),
+	OP("^", BOOL_XOR), OP("|", BOOL_OR), OP("!", NOT), OP(".", DOT),
+	OP("~", TILDE), OP("?", QUESTION), OP(":", COLON), OP(";", SEMICOLON),
+	OP(",", COMMA), OP("(", LPAREN), OP(")", RPAREN), OP("[", LBRACKET),
+	OP("]", RBRACKET), OP("{", LBRACE), OP("}", RBRACE),
+
+	OP(">>", RSHIFT), OP(">>=", RSHIFT_ASSIGN), OP("<<", LSHIFT),
+	OP("<<=", LSHIFT_ASSIGN), OP("+=", ADD_ASSIGN), OP("++", INC_OP),
+	OP("-=", SUB_ASSIGN), OP("--", DEC_OP), OP("*=", MUL_ASSIGN),
+	OP("/=", DIV_ASSIGN), OP("%=", MOD_ASSIGN), OP("&=", AND_ASSIGN),
+	OP("^=", XOR_ASSIGN), OP("|=", OR_ASSIGN), OP("&&", LOG_AND),
+	OP("||", LOG_OR), OP("->", PTR_OP), OP("<=", LE_OP), OP(">=", GE_OP),
+	OP("!=", NE_OP), OP("==", EQ_OP),
+};
+#undef OP
+
+constexpr size_t NUM_OPERATORS = sizeof(operators) / sizeof(operators[0]);
+
+static_assert(NUM_OPERATORS < OPERATOR_STATES,
+	"too many operators for OPERATOR_STATES");
+
+// State s > 0 stands for operators[s - 1], the start state for ""
+constexpr size_t state_len(size_t s)
+{
+	return s == 0 ? 0 : operators[s - 1].len;
+}
+
+constexpr const char *state_text(size_t s)
+{
+	return s == 0 ? "" : operators[s - 1].text;
+}
+
+constexpr bool same_prefix(const char *a, const char *b, size_t n)
+{
+	return n == 0 || (*a == *b && same_prefix(a + 1, b + 1, n - 1));
+}
+
+// Whether operators[op] is state s's text followed by ch
+constexpr bool extends(size_t op, size_t s, char ch)
+{
+	return operators[op].len == state_len(s) + 1 &&
+		same_prefix(operators[op].text, state_text(s), state_len(s)) &&
+		operators[op].text[state_len(s)] == ch;
+}
+
+constexpr uint8_t find_next(size_t s, char ch, size_t op=0)
+{
+	return op == NUM_OPERATORS ? 0 :
+		extends(op, s, ch) ? uint8_t(op + 1) : find_next(s, ch, op + 1);
+}
+
+constexpr uint8_t transition(size_t s, int ch)
+{
+	return s > NUM_OPERATORS ? 0 : find_next(s, char(ch));
+}
+
+constexpr Token::Kind accepts(size_t s)
+{
+	return (s == 0 || s > NUM_OPERATORS) ? Token::ZERO : operators[s - 1].kind;
+}
+
+constexpr size_t walk(const char *text, size_t len, size_t s=0)
+{
+	return len == 0 ? s : walk(text + 1, len - 1, transition(s, *text));
+}
+
+// Spelling out each operator from the start state has to end in its own
+// state, which fails if what it extends isn't an operator or if it's
+// listed twice
+constexpr bool all_reachable(size_t op=0)
+{
+	return op == NUM_OPERATORS ||
+		(walk(operators[op].text, operators[op].len) == op + 1 &&
+		 all_reachable(op + 1));
+}
+
+static_assert(all_reachable(), "an operator can't be reached in the DFA");
+
+} // anonymous namespace
+
+#define T4(s, c) \
+	transition(s, c), transition(s, c + 1), \
+	transition(s, c + 2), transition(s, c + 3)
+#define T16(s, c) T4(s, c), T4(s, c + 4), T4(s, c + 8), T4(s, c + 12)
+#define ROW(s) { \
+	T16(s, 0), T16(s, 16), T16(s, 32), T16(s, 48), \
+	T16(s, 64), T16(s, 80), T16(s, 96), T16(s, 112) }
+#define ROW8(s) \
+	ROW(s), ROW(s + 1), ROW(s + 2), ROW(s + 3), \
+	ROW(s + 4), ROW(s + 5), ROW(s + 6), ROW(s + 7)
+
+static_assert(OPERATOR_STATES == 48, "operator_dfa needs more rows");
+
+constexpr uint8_t operator_dfa[OPERATOR_STATES][128] = {
+	ROW8(0), ROW8(8), ROW8(16), ROW8(24), ROW8(32), ROW8(40),
+};
+
+#undef ROW8
+#undef ROW
+#undef T16
+#undef T4
+
+#define K4(s) accepts(s), accepts(s + 1), accepts(s + 2), accepts(s + 3)
+#define K16(s) K4(s), K4(s + 4), K4(s + 8), K4(s + 12)
+
+constexpr Token::Kind operator_kinds[OPERATOR_STATES] = {
+	K16(0), K16(16), K16(32),
+};
+
+#undef K16
+#undef K4
+
+} // namespace Soda
@@ -0,0 +1,29 @@
+#ifndef SODA_OPERATORS_H
+#define SODA_OPERATORS_H
+
+#include <soda/token.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace Soda
+{
+
+// Operators and punctuation are recognised by a DFA over ASCII, generated
+// at compile time from the list of operators. State 0 is the start state.
+// Every other state is the operator spelled out on the way to it. A
+// transition to 0 means the current operator can't be extended, so the
+// longest match is the state the walk stopped in.
+const size_t OPERATOR_STATES = 48;
+
+extern const uint8_t operator_dfa[OPERATOR_STATES][128];
+// The kind each state accepts, ZERO for the start state
+extern const Token::Kind operator_kinds[OPERATOR_STATES];
+
+inline bool is_operator_start(char32_t ch)
+{
+	return ch < 0x80 && operator_dfa[0][ch] != 0;
+}
+
+} // namespace Soda
+
+#endif // SODA_OPERATORS_H
@@ -0,0 +1,157 @@
+#include <soda/sodainc.h> // pch
+#include <soda/parallellexer.h>
+#include <soda/encoding.h>
+#include <soda/lexer.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Soda
+{
+
+namespace
+{
+
+// A piece of the input and what was lexed of it
+struct Chunk
+{
+	size_t begin, end;
+	TokenList tokens; // those starting in [begin, end)
+	Token next;       // the first token starting at or after end
+	size_t resume;    // where next was lexed from
+	bool done;        // the input ended before a next token
+
+	Chunk(size_t begin, size_t end)
+		: begin(begin), end(end), resume(0), done(false)
+	{
+	}
+};
+
+// Lex text from offset at until a token starts at or after chunk.end. The
+// last token kept may run on past it, the way a string can.
+void lex_chunk(const char *text, size_t size, size_t at, Chunk& chunk)
+{
+	Lexer lex(text + at, text + size, ENC_UTF8, at);
+	chunk.tokens.clear();
+	chunk.done = false;
+	for (;;)
+	{
+		size_t from = lex.offset();
+		if (lex.next() == Token::END)
+		{
+			chunk.done = true;
+			return;
+		}
+		if (lex.token.location.start() >= chunk.end)
+		{
+			chunk.next = lex.token;
+			chunk.resume = from;
+			return;
+		}
+		chunk.tokens.push_back(lex.token);
+	}
+}
+
+bool same_token(const Token& a, const Token& b)
+{
+	return a.kind == b.kind && a.location.start() == b.location.start() &&
+	       a.location.end() == b.location.end();
+}
+
+} // anonymous namespace
+
+TokenList tokenize_parallel(const char *begin, const char *end,
+                            LineTable *lines, unsigned threads,
+                            size_t min_chunk)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	size_t size = end - begin;
+	size_t count = std::min<size_t>(threads,
+	                                size / std::max<size_t>(min_chunk, 1));
+	if (count <= 1)
+		return tokenize(begin, end, lines);
+
+	// Offsets are into the UTF-8 text, as with Input
+	const char *text = begin;
+	std::unique_ptr<char[]> transcoded;
+	Encoding enc = detect_encoding(begin, end);
+	if (enc != ENC_UTF8)
+	{
+		transcoded.reset(new char[utf8_size_bound(enc, size)]);
+		size = transcode_to_utf8(enc, begin, end, transcoded.get()) -
+		       transcoded.get();
+		text = transcoded.get();
+	}
+
+	// Split just after a line break near each even share of the input
+	std::vector<Chunk> chunks;
+	size_t start = 0;
+	for (size_t i = 1; i < count && start < size; i++)
+	{
+		size_t at = std::max(start, size / count * i);
+		const void *nl = std::memchr(text + at, '\n', size - at);
+		if (!nl)
+			break;
+		size_t split = static_cast<const char*>(nl) - text + 1;
+		chunks.emplace_back(start, split);
+		start = split;
+	}
+	// a token can start at the very end, after an unclosed quote
+	chunks.emplace_back(start, std::numeric_limits<size_t>::max());
+
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < chunks.size(); i++)
+	{
+		Chunk *chunk = &chunks[i];
+		workers.emplace_back([text, size, chunk]()
+			{ lex_chunk(text, size, chunk->begin, *chunk); });
+	}
+	if (lines)
+		lines->scan(text, text + size);
+	lex_chunk(text, size, 0, chunks[0]);
+	for (auto& worker : workers)
+		worker.join();
+
+	// Each chunk is right from the token the one before it stopped at,
+	// or is lexed again from where that token was lexed from
+	size_t total = chunks[0].tokens.size();
+	std::vector<size_t> keep_from(chunks.size(), 0);
+	for (size_t i = 1; i < chunks.size(); i++)
+	{
+		Chunk& prev = chunks[i - 1];
+		Chunk& chunk = chunks[i];
+		if (prev.done)
+		{
+			chunk.tokens.clear();
+			chunk.done = true;
+			continue;
+		}
+		if (prev.next.location.start() >= chunk.end)
+		{
+			// swallowed whole by the token or comment before
+			chunk.tokens.clear();
+			chunk.next = prev.next;
+			chunk.resume = prev.resume;
+			chunk.done = false;
+			continue;
+		}
+		size_t at = chunk.tokens.find(prev.next.location.start());
+		if (at < chunk.tokens.size() && same_token(chunk.tokens[at], prev.next))
+			keep_from[i] = at;
+		else
+			lex_chunk(text, size, prev.resume, chunk);
+		total += chunk.tokens.size() - keep_from[i];
+	}
+
+	TokenList tokens;
+	tokens.reserve(total);
+	for (size_t i = 0; i < chunks.size(); i++)
+		tokens.append(chunks[i].tokens, keep_from[i]);
+	return tokens;
+}
+
+} // namespace Soda
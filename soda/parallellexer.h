@@ -0,0 +1,28 @@
+#ifndef SODA_PARALLELLEXER_H
+#define SODA_PARALLELLEXER_H
+
+#include <soda/linetable.h>
+#include <soda/tokenlist.h>
+#include <cstddef>
+
+namespace Soda
+{
+
+// Pieces smaller than this aren't worth a thread of their own
+static const size_t PARALLEL_MIN_CHUNK = 256 * 1024;
+
+// Tokenize [begin, end) like tokenize() does, with the same result, but
+// split at line breaks into pieces lexed on up to threads threads (0 for
+// one per core). Each piece is lexed speculatively, as though it started
+// between tokens. The lexer carries nothing from one token to the next but
+// where it stopped, so a piece is right from the first token it shares
+// with the piece before it. One without that token (it started inside a
+// string, character literal or block comment) is lexed again from where
+// the piece before it left off.
+TokenList tokenize_parallel(const char *begin, const char *end,
+                            LineTable *lines=nullptr, unsigned threads=0,
+                            size_t min_chunk=PARALLEL_MIN_CHUNK);
+
+} // namespace Soda
+
+#endif // SODA_PARALLELLEXER_H
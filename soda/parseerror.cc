@@ -4,12 +4,13 @@ namespace Soda
 {
 
 ParseError::ParseError(const char *what,
-                         const std::string& filename,
-                         SourceLocation location,
-                         const std::string& message)
+                       const SourceManager& sources,
+                       SourceLocation location,
+                       const std::string& message)
 	: std::runtime_error(what),
-	  fn(filename),
-	  location(location),
+	  fn(sources.filename(location.start())),
+	  start(sources.position(location.start())),
+	  end(sources.position(location.end())),
 	  msg(message)
 {
 }
@@ -29,14 +30,11 @@ enum Color
 void format_exception(std::ostream& stream, ParseError& err)
 {
 	stream << "\x1B[31merror\x1B[0m:\x1B[33m" << err.fn << "\x1B[0m:";
-	if (err.location.line.start != err.location.line.end)
-		stream << "\x1B[35m" << err.location.line.start + 1 << "-" << err.location.line.end + 1 << "\x1B[0m:";
+	if (err.start.line != err.end.line)
+		stream << "\x1B[35m" << err.start.line + 1 << "-" << err.end.line + 1 << "\x1B[0m:";
 	else
-		stream << "\x1B[35m" << err.location.line.start + 1 << "\x1B[0m:";
-	if (err.location.column.start != err.location.column.start)
-		stream << "\x1B[36m" << err.location.column.start - 1 << "-" << err.location.column.end - 1;
-	else
-		stream << "\x1B[36m" << err.location.column.start - 1;
+		stream << "\x1B[35m" << err.start.line + 1 << "\x1B[0m:";
+	stream << "\x1B[36m" << err.start.column;
 	if (!err.msg.empty())
 		stream << "\x1B[0m: " << err.msg << "\n";
 	else
@@ -1,6 +1,7 @@
 #ifndef SODA_PARSEERROR_H
 #define SODA_PARSEERROR_H
 
+#include <soda/sourcemanager.h>
 #include <soda/sourcelocation.h>
 #include <stdexcept>
 #include <string>
@@ -12,18 +13,19 @@ namespace Soda
 class ParseError : public std::runtime_error
 {
 public:
+	// location is resolved to a file, line and column using sources
 	ParseError(const char *what,
-	            const std::string& filename,
-	            SourceLocation location,
-	            const std::string& message);
+	           const SourceManager& sources,
+	           SourceLocation location,
+	           const std::string& message);
 	const std::string& filename() const noexcept { return fn; }
-	int position() const noexcept { return location.offset.start; }
-	int line() const noexcept { return location.line.start; }
-	int column() const noexcept { return location.column.start; }
+	int position() const noexcept { return start.offset; }
+	int line() const noexcept { return start.line; }
+	int column() const noexcept { return start.column; }
 	const std::string& message() const noexcept { return msg; }
 private:
 	std::string fn;
-	SourceLocation location;
+	SourcePosition start, end;
 	std::string msg;
 	friend void format_exception(std::ostream&, ParseError&);
 };
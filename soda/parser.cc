@@ -1,18 +1,19 @@
 #include <soda/sodainc.h> // pch
 #include <soda/parser.h>
 #include <soda/lexer.h>
+#include <soda/sourcemanager.h>
+#include <soda/tokenstream.h>
 #include <deque>
 #include <cassert>
 #include <stack>
 #include <sstream>
-#include <fstream>
 
 namespace Soda
 {
 
 #define SYNTAX_ERROR(msg) \
-	throw Soda::SyntaxError("syntax error", tu.fn, \
-		SourceLocation(tokens[index].location), msg)
+	throw Soda::SyntaxError("syntax error", tu.sources, \
+		tokens.current().location, msg)
 
 #define CHECK_SEMI(exp)                                             \
 	do { if (!ACCEPT(';')) {                                        \
@@ -26,31 +27,56 @@ struct Parser
 {
 
 TU& tu;
-SourcePosition last_end;
-TokenList tokens;
-size_t index;
+size_t last_end;
+Lexer& lexer;
+TokenStream& tokens;
 
-Parser(std::istream& stream, TU& tu)
-	: tu(tu), tokens(std::move(tokenize(stream))), index(0)
+Parser(Lexer& lexer, TokenStream& tokens, TU& tu)
+	: tu(tu), last_end(0), lexer(lexer), tokens(tokens)
 {
-	tokens.push_back(Token());
-	tokens.back().kind = Token::END;
 }
 
+// Lets a rule back up to where it started if it turns out not to match.
+// The tokens since then are kept until the rule commits or returns.
+struct Backtrack
+{
+	TokenStream& tokens;
+	size_t mark;
+	bool active;
+
+	Backtrack(TokenStream& tokens)
+		: tokens(tokens), mark(tokens.mark()), active(true) {}
+	~Backtrack() { commit(); }
+
+	// the rule has matched and won't back up
+	void commit()
+	{
+		if (active)
+			tokens.release(mark);
+		active = false;
+	}
+
+	void reset()
+	{
+		tokens.reset(mark);
+		commit();
+	}
+};
+
 // retrieve the current token kind
 Token::Kind current()
 {
-	assert(index < tokens.size());
-	return tokens[index].kind;
+	return tokens.current().kind;
 }
 
 // advance in the tokens and return the next (ie. new current) token kind
 Token::Kind next()
 {
-	if (index < (tokens.size() - 1))
+	if (current() != Token::END)
 	{
-		last_end = tokens[index].location.end();
-		return tokens[++index].kind;
+		last_end = tokens.current().location.end();
+		tokens.next();
+		return current();
 	}
 	return Token::END;
 }
@@ -58,26 +84,64 @@ Token::Kind next()
 // look ahead of the current token by n tokens and return its kind
 Token::Kind lookahead(size_t n=1)
 {
-	size_t new_index = index + n;
-	if (new_index < tokens.size())
-		return tokens[new_index].kind;
-	return Token::END;
+	return tokens.peek(n).kind;
 }
 
-// gets the text of the current token
-const std::u32string& text() const
+// gets the text of the current token, decoded from the source
+std::u32string text()
 {
-	return tokens[index].text;
+	return lexer.text(tokens.current());
 }
 
-// gets the start position of the current token
-SourcePosition start() const
+// appends the value of the current (STR_LIT) token to out
+void literal(std::u32string& out)
 {
-	return tokens[index].location.start();
+	if (!lexer.literal(tokens.current(), out))
+	{
+		std::stringstream ss;
+		ss << "malformed escape sequence in string literal `" << text()
+		   << "'";
+		SYNTAX_ERROR(ss.str());
+	}
 }
 
-// gets the end position of the previous  token
-SourcePosition end() const
+// the lookahead past the name p_fq_ident_expr() would take from lookahead
+// n, or n if there isn't one. Lets a rule check it's going to match before
+// building any nodes.
+size_t fq_ident_end(size_t n)
+{
+	if (lookahead(n) != Token::IDENT)
+		return n;
+	n++;
+	if (lookahead(n) == Token::DOT)
+	{
+		n++;
+		while (lookahead(n) == Token::IDENT)
+		{
+			n++;
+			if (lookahead(n) == Token::DOT)
+				n++;
+			else
+				break;
+		}
+	}
+	return n;
+}
+
+// gets the interned name of the current (IDENT) token
+Symbol symbol()
+{
+	return tokens.current().symbol;
+}
+
+// gets the start offset of the current token
+size_t start()
+{
+	return tokens.current().location.start();
+}
+
+// gets the end offset of the previous  token
+size_t end() const
 {
 	return last_end;
 }
@@ -159,8 +223,8 @@ void parse()
 //> func_decl ::= type_ident ident_expr '(' arg_list ')' ';' .
 StmtPtr p_func_decl()
 {
-	SourcePosition spos = start();
-	size_t save_index = index;
+	size_t spos = start();
+	Backtrack bt(tokens);
 	TypeIdentPtr type(p_type_ident());
 	if (type)
 	{
@@ -169,6 +233,7 @@ StmtPtr p_func_decl()
 		{
 			if (ACCEPT('('))
 			{
+				bt.commit();
 				StmtList args; p_arg_list(args);
 				EXPECT(')');
 				CHECK_SEMI("external function declaration");
@@ -177,15 +242,14 @@ StmtPtr p_func_decl()
 			}
 		}
 	}
-	index = save_index;
+	bt.reset();
 	return StmtPtr(nullptr);
 }
 
 //> ccode ::= '[' CCODE [ccode_params] ']' .
 StmtPtr p_ccode()
 {
-	SourcePosition spos = start();
-	size_t saved_index = index;
+	size_t spos = start();
 	if (ACCEPT('['))
 	{
 		EXPECT(Token::CCODE);
@@ -209,7 +273,6 @@ StmtPtr p_ccode()
 			SYNTAX_ERROR(ss.str());
 		}
 	}
-	index = saved_index;
 	return StmtPtr(nullptr);
 }
 
@@ -234,12 +297,14 @@ void p_ccode_params(CCodeParamList& lst)
 //> ccode_param ::= IDENT '=' STR_LIT .
 CCodeParamPtr p_ccode_param()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	std::u32string name(text());
 	if (ACCEPT(Token::IDENT))
 	{
 		EXPECT('=');
-		std::u32string value(text());
+		std::u32string value;
+		if (current() == Token::STR_LIT)
+			literal(value);
 		EXPECT(Token::STR_LIT);
 		return CCodeParamPtr(new CCodeParam(std::move(name), std::move(value), spos, end()));
 	}
@@ -255,7 +320,7 @@ void p_tu(TU& tu)
 //> namespace ::= NAMESPACE [ IDENT ] '{' stmt_list '}' .
 StmtPtr p_namespace_stmt()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(Token::NAMESPACE))
 	{
 		IdentPtr name(nullptr);
@@ -273,7 +338,7 @@ StmtPtr p_namespace_stmt()
 //> import_stmt ::= IMPORT fq_ident_expr ';' .
 StmtPtr p_import_stmt()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(Token::IMPORT))
 	{
 		IdentPtr name(p_fq_ident_expr());
@@ -293,7 +358,7 @@ StmtPtr p_import_stmt()
 //> alias ::= ALIAS IDENT '=' IDENT ';' .
 StmtPtr p_alias()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(Token::ALIAS))
 	{
 		IdentPtr type(p_ident_expr());
@@ -324,7 +389,7 @@ StmtPtr p_alias()
 //> delegate ::= DELEGATE type_ident IDENT '(' arg_list ')' ';'
 StmtPtr p_delegate_stmt()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(Token::DELEGATE))
 	{
 		TypeIdentPtr type(p_type_ident());
@@ -359,15 +424,15 @@ StmtPtr p_delegate_stmt()
 //> type_ident ::= [const] fq_ident_expr .
 TypeIdentPtr p_type_ident()
 {
-	SourcePosition spos = start();
-	size_t start_index = index;
+	size_t spos = start();
+	Backtrack bt(tokens);
 	bool is_const = false;
 	if (ACCEPT(Token::CONST))
 		is_const = true;
-	IdentPtr type(p_fq_ident_expr());
-	if (type)
-		return TypeIdentPtr(new TypeIdent(type->name, is_const, spos, end()));
-	index = start_index;
+	Symbol name = p_fq_name();
+	if (name != NO_SYMBOL)
+		return TypeIdentPtr(new TypeIdent(name, is_const, spos, end()));
+	bt.reset();
 	return TypeIdentPtr(nullptr);
 }
 
@@ -396,8 +461,8 @@ void p_specifiers(AccessModifier& access, StorageClassSpecifier& storage)
 //> var_decl ::= specifiers type_ident ident_expr [ '=' expr ] ';' .
 StmtPtr p_var_decl(bool as_arg=false)
 {
-	SourcePosition spos = start();
-	size_t save_index = index;
+	size_t spos = start();
+	Backtrack bt(tokens);
 	AccessModifier access;
 	StorageClassSpecifier storage;
 	p_specifiers(access, storage);
@@ -407,6 +472,7 @@ StmtPtr p_var_decl(bool as_arg=false)
 		IdentPtr name(p_ident_expr());
 		if (name)
 		{
+			bt.commit();
 			if (ACCEPT('='))
 			{
 				ExprPtr expr(p_expr());
@@ -432,18 +498,27 @@ StmtPtr p_var_decl(bool as_arg=false)
 			}
 		}
 	}
-	index = save_index;
+	bt.reset();
 	return StmtPtr(nullptr);
 }
 
 //> func_def ::= specifiers type_ident ident_expr '(' arg_list ')' stmt .
 StmtPtr p_func_def()
 {
-	SourcePosition spos = start();
-	size_t save_index = index;
+	size_t spos = start();
+	Backtrack bt(tokens);
 	AccessModifier access;
 	StorageClassSpecifier storage;
 	p_specifiers(access, storage);
+	// only go on to build nodes if type_ident IDENT '(' follows
+	size_t n = (current() == Token::CONST) ? 1 : 0;
+	size_t name_at = fq_ident_end(n);
+	if (name_at == n || lookahead(name_at) != Token::IDENT ||
+	    lookahead(name_at + 1) != Token::LPAREN)
+	{
+		bt.reset();
+		return StmtPtr(nullptr);
+	}
 	TypeIdentPtr type(p_type_ident());
 	if (type)
 	{
@@ -452,6 +527,7 @@ StmtPtr p_func_def()
 		{
 			if (ACCEPT('('))
 			{
+				bt.commit();
 				StmtList args; p_arg_list(args);
 				EXPECT(')');
 				EXPECT('{');
@@ -463,7 +539,7 @@ StmtPtr p_func_def()
 			}
 		}
 	}
-	index = save_index;
+	bt.reset();
 	return StmtPtr(nullptr);
 }
 
@@ -496,7 +572,7 @@ void p_bases_list(ExprList& lst)
 //> class_def ::= CLASS IDENT [':' bases_list ] compound_stmt ';' .
 StmtPtr p_class_def()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(Token::CLASS))
 	{
 		IdentPtr name(p_ident_expr());
@@ -525,7 +601,7 @@ StmtPtr p_class_def()
 //> case ::= CASE expr stmt .
 StmtPtr p_case()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(Token::CASE))
 	{
 		ExprPtr expr(p_expr());
@@ -552,7 +628,7 @@ StmtPtr p_case()
 //> default ::= DEFAULT stmt .
 StmtPtr p_default()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(Token::DEFAULT))
 	{
 		StmtPtr stmt(p_stmt());
@@ -592,7 +668,7 @@ void p_case_list(StmtList& case_list)
 //> switch_stmt ::= SWITCH '(' expr ')' '{' case_list '}' .
 StmtPtr p_switch_stmt()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(Token::SWITCH))
 	{
 		EXPECT('(');
@@ -610,7 +686,7 @@ StmtPtr p_switch_stmt()
 //> if_stmt ::= IF '(' expr ')' stmt [ ELSE stmt ] .
 StmtPtr p_if_stmt()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(Token::IF))
 	{
 		EXPECT('(');
@@ -644,7 +720,7 @@ StmtPtr p_if_stmt()
 //> return_stmt ::= RETURN [ expr ] ';' .
 StmtPtr p_return_stmt()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(Token::RETURN))
 	{
 		ExprPtr expr(p_expr());
@@ -657,7 +733,7 @@ StmtPtr p_return_stmt()
 //> break_stmt ::= BREAK ';' .
 StmtPtr p_break_stmt()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(Token::BREAK))
 	{
 		CHECK_SEMI("break");
@@ -669,7 +745,7 @@ StmtPtr p_break_stmt()
 //> compound_stmt ::= '{' p_stmt_list '}' .
 StmtPtr p_compound_stmt(bool top_level=false)
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT('{'))
 	{
 		StmtList stmts;
@@ -683,7 +759,7 @@ StmtPtr p_compound_stmt(bool top_level=false)
 //> expr_stmt ::= call_expr ';' .
 StmtPtr p_expr_stmt()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	ExprPtr expr(p_expr());
 	if (expr)
 	{
@@ -696,7 +772,7 @@ StmtPtr p_expr_stmt()
 //> empty_stmt ::= ';'
 StmtPtr p_empty_stmt()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	if (ACCEPT(';'))
 		return StmtPtr(new EmptyStmt(spos, end()));
 	return StmtPtr(nullptr);
@@ -768,7 +844,7 @@ void p_stmt_list(StmtList& lst, bool top_level=false)
 ExprPtr p_number_expr()
 {
 	int base;
-	SourcePosition spos = start();
+	size_t spos = start();
 
 	switch (current())
 	{
@@ -783,22 +859,8 @@ ExprPtr p_number_expr()
 	if (base < 0)
 		return ExprPtr(nullptr);
 
-	try
-	{
-		if (base == 0)
-		{
-			ExprPtr expr(new Float(text(), spos, end()));
-			next();
-			return expr;
-		}
-		else
-		{
-			ExprPtr expr(new Integer(text(), base, spos, end()));
-			next();
-			return expr;
-		}
-	}
-	catch (std::invalid_argument&)
+	NumberValue num = tokens.current().number();
+	if (num.status != NumberValue::VALID)
 	{
 		std::stringstream ss;
 		ss << "failed to parse ";
@@ -808,10 +870,15 @@ ExprPtr p_number_expr()
 			ss << "base " << base << " integer `" << text() << "'";
 		if (text().empty())
 			ss << ". prefixed numbers must have at least 1 digit";
+		else if (num.status == NumberValue::OUT_OF_RANGE)
+			ss << ", it's out of range";
 		SYNTAX_ERROR(ss.str());
 	}
 
-	return ExprPtr(nullptr);
+	next();
+	if (base == 0)
+		return ExprPtr(new Float(num.real, spos, end()));
+	return ExprPtr(new Integer(num.integer, spos, end()));
 }
 
 //> paren_expr ::= '(' expr ')' .
@@ -834,9 +901,10 @@ IdentPtr p_ident_expr()
 {
 	if (current() == Token::IDENT)
 	{
-		std::u32string name(text());
+		size_t spos = start();
+		Symbol name = symbol();
 		EXPECT(Token::IDENT);
-		return IdentPtr(new Ident(name, start(), end()));
+		return IdentPtr(new Ident(name, spos, end()));
 	}
 	return IdentPtr(nullptr);
 }
@@ -844,50 +912,71 @@ IdentPtr p_ident_expr()
 //> fq_ident_expr ::= IDENT { '.' IDENT } .
 IdentPtr p_fq_ident_expr()
 {
-	if (current() == Token::IDENT)
+	size_t spos = start();
+	Symbol name = p_fq_name();
+	if (name != NO_SYMBOL)
+		return IdentPtr(new Ident(name, spos, end()));
+	return IdentPtr(nullptr);
+}
+
+// the name of an fq_ident_expr, NO_SYMBOL if there isn't one
+Symbol p_fq_name()
+{
+	if (current() != Token::IDENT)
+		return NO_SYMBOL;
+	Symbol name = symbol();
+	EXPECT(Token::IDENT);
+	// a dotted name is interned whole
+	if (ACCEPT(Token::DOT))
 	{
-		SourcePosition spos = start();
-		std::u32string name;
+		std::u32string fq(tu.interner.text(name));
+		fq += U".";
 		while (current() == Token::IDENT)
 		{
-			name += text();
+			fq += tu.interner.text(symbol());
 			EXPECT(Token::IDENT);
 			if (ACCEPT(Token::DOT))
-				name += U".";
+				fq += U".";
 			else
 				break;
 		}
-		return IdentPtr(new Ident(name, spos, end()));
+		name = tu.interner.intern(fq);
 	}
-	return IdentPtr(nullptr);
+	return name;
 }
 
 //> strlit_expr ::= STR_LIT { STR_LIT } .
 ExprPtr p_strlit_expr()
 {
-	SourcePosition spos = start();
-	if (ACCEPT(Token::STR_LIT))
+	size_t spos = start();
+	if (current() == Token::STR_LIT)
 	{
-		std::u32string txt;
+		// adjacent literals are joined and pooled as one
+		std::u32string value;
 		do
 		{
-			txt += text().substr(1, text().size() - 2);
+			literal(value);
 			next();
 		} while (current() == Token::STR_LIT);
-		return ExprPtr(new StrLit(txt, spos, end()));
+		return ExprPtr(new StrLit(tu.literals.intern(value), spos, end()));
 	}
 	return ExprPtr(nullptr);
 }
 
 ExprPtr p_call_expr()
 {
-	SourcePosition spos = start();
-	size_t start_index = index;
+	// rule a call out before building the name only to throw it away
+	size_t n = fq_ident_end(0);
+	if (n == 0 || lookahead(n) != Token::LPAREN)
+		return ExprPtr(nullptr);
+	size_t spos = start();
+	Backtrack bt(tokens);
 	IdentPtr ident(p_fq_ident_expr());
 	if (ident)
 	{
 		if (ACCEPT('('))
 		{
+			bt.commit();
 			ExprList args;
 			do
 			{
@@ -903,7 +992,7 @@ ExprPtr p_call_expr()
 			                            spos, end()));
 		}
 	}
-	index = start_index;
+	bt.reset();
 	return ExprPtr(nullptr);
 }
 
@@ -941,7 +1030,7 @@ ExprPtr p_primary_expr()
 //> expr ::= primary_expr [ bin_op_rhs ] .
 ExprPtr p_expr()
 {
-	SourcePosition spos = start();
+	size_t spos = start();
 	ExprPtr lhs(p_primary_expr());
 	if (!lhs)
 		return ExprPtr(nullptr);
@@ -949,7 +1038,7 @@ ExprPtr p_expr()
 }
 
 //> bin_op_rhs ::= { ??OPERATORS?? primary_expr } .
-ExprPtr p_bin_op_rhs(int expr_prec, Expr* lhs, SourcePosition spos)
+ExprPtr p_bin_op_rhs(int expr_prec, Expr* lhs, size_t spos)
 {
 	while (true)
 	{
@@ -977,22 +1066,77 @@ ExprPtr p_bin_op_rhs(int expr_prec, Expr* lhs, SourcePosition spos)
 
 }; // struct Parser
 
+// Parse from lex, which is lexing file. What the lexer found in the file
+// is handed over to it even if parsing fails part way.
+static void parse(TU& tu, SourceFile& file, Lexer& lex, TokenStream& tokens)
+{
+	try
+	{
+		Parser p(lex, tokens, tu);
+		p.parse();
+	}
+	catch (...)
+	{
+		lex.finish(file);
+		throw;
+	}
+	lex.finish(file);
+}
+
+static void parse(TU& tu, SourceFile& file, Lexer& lex)
+{
+	TokenStream tokens(lex);
+	parse(tu, file, lex, tokens);
+}
+
 void parse(TU& tu, std::istream& stream)
 {
-	Parser p(stream, tu);
-	p.parse();
+	SourceFile& file = tu.sources.add_stream(tu.fn);
+	Lexer lex(stream, &file.lines, file.base, &tu.interner);
+	parse(tu, file, lex);
+}
+
+void parse(TU& tu, const char *data, size_t size)
+{
+	parse(tu, tu.sources.add_buffer(tu.fn, data, size));
 }
 
 void parse(TU& tu, const std::string& str)
 {
-	std::stringstream ss(str);
-	parse(tu, ss);
+	parse(tu, str.data(), str.size());
+}
+
+void parse(TU& tu, SourceFile& file)
+{
+	Lexer lex(file.buffer->begin(), file.buffer->end(), nullptr, file.base,
+	          &tu.interner);
+	parse(tu, file, lex);
 }
 
 void parse(TU& tu)
 {
-	std::ifstream stream(tu.fn);
-	parse(tu, stream);
+	SourceFile *file = tu.sources.add_file(tu.fn);
+	if (file)
+		parse(tu, *file);
+}
+
+ParseContext::ParseContext()
+	: tokens(lexer)
+{
+}
+
+void ParseContext::parse(TU& tu, const char *data, size_t size)
+{
+	SourceFile& file = tu.sources.add_buffer(tu.fn, data, size);
+	lexer.reset(file.buffer->begin(), file.buffer->end(), nullptr, file.base,
+	            &tu.interner);
+	tokens.restart();
+	Soda::parse(tu, file, lexer, tokens);
+}
+
+void ParseContext::parse(TU& tu, const std::string& str)
+{
+	parse(tu, str.data(), str.size());
 }
 
 } // namespace Soda
@@ -2,22 +2,51 @@
 #define SODA_PARSER_H
 
 #include <soda/ast.h>
+#include <soda/lexer.h>
 #include <soda/syntaxerror.h>
+#include <soda/tokenstream.h>
 #include <istream>
 #include <string>
 
 namespace Soda
 {
 
-// Parse UTF-8 stream
+// Parse UTF-8 stream. Only the text around the tokens in use is held, so
+// a long stream's file has no buffer afterwards.
 void parse(TU& tu, std::istream& stream);
 
+// Parse UTF-8 buffer, the memory is used in-place
+void parse(TU& tu, const char *data, size_t size);
+
 // Parse UTF-8 string
 void parse(TU& tu, const std::string& str);
 
-// Open tu.fn and parse resulting UTF-8 stream
+// Parse a UTF-8 file already loaded into tu.sources
+void parse(TU& tu, SourceFile& file);
+
+// Map tu.fn and parse the resulting UTF-8 buffer
 void parse(TU& tu);
 
+// For parsing many inputs one after another. Only the lexer and token
+// buffers are reused from one parse to the next. A parse still allocates
+// each AST node and whatever the TU keeps: its source entry, interners,
+// identifiers and literals.
+class ParseContext
+{
+public:
+	ParseContext();
+	// Parse a UTF-8 buffer like parse() does, the memory is used in-place
+	void parse(TU& tu, const char *data, size_t size);
+	void parse(TU& tu, const std::string& str);
+
+private:
+	Lexer lexer;
+	TokenStream tokens;
+
+	ParseContext(const ParseContext&);
+	ParseContext& operator=(const ParseContext&);
+};
+
 } // namespace Soda
 
 #endif // SODA_PARSER_H
@@ -0,0 +1,71 @@
+#include <soda/sodainc.h> // pch
+#include <soda/relexer.h>
+#include <soda/lexer.h>
+#include <algorithm>
+
+namespace Soda
+{
+
+// Room for a whole code point between a kept token's start and the edit
+static const size_t MARGIN = 4;
+
+// Where lexing carried on after tok, past a closing quote
+static size_t lexed_end(const Token& tok)
+{
+	if (tok.kind == Token::STR_LIT || tok.kind == Token::CHAR_ICONST)
+		return tok.location.end() + 1;
+	return tok.location.end();
+}
+
+TokenEdit relex(TokenList& tokens, const char *begin, const char *end,
+                const TextEdit& edit)
+{
+	// A token's lexing looks as far as the first character of the next,
+	// so the one before the first token near the edit is lexed again too
+	size_t near = tokens.find(edit.offset >= MARGIN ?
+	                          edit.offset - MARGIN + 1 : 0);
+	size_t keep = near ? near - 1 : 0;
+	size_t from = keep ? lexed_end(tokens[keep - 1]) : 0;
+
+	// Old tokens past the edit that the new ones are checked against, and
+	// the shift that lines them up (unsigned wraparound subtracts)
+	size_t old_end = edit.offset + edit.removed;
+	size_t new_end = edit.offset + edit.inserted;
+	uint32_t shift = uint32_t(edit.inserted - edit.removed);
+	size_t old = keep;
+
+	TokenList fresh;
+	Lexer lex(begin + from, end, ENC_UTF8, from);
+	bool synced = false;
+	while (lex.next() != Token::END)
+	{
+		const Token& tok = lex.token;
+		if (tok.location.start() >= new_end)
+		{
+			while (old < tokens.size() &&
+			       (tokens.start(old) < old_end ||
+			        tokens.start(old) + edit.inserted <
+			        tok.location.start() + edit.removed))
+				old++;
+			if (old < tokens.size() && tokens.kind(old) == tok.kind &&
+			    uint32_t(tokens.start(old) + shift) == tok.location.offset &&
+			    tokens.location(old).length == tok.location.length)
+			{
+				synced = true;
+				break;
+			}
+		}
+		fresh.push_back(tok);
+	}
+	if (!synced)
+		old = tokens.size();
+
+	tokens.shift(old, shift);
+	size_t removed = old - keep;
+	tokens.replace(keep, removed, fresh, 0, fresh.size());
+
+	TokenEdit result = { keep, removed, fresh.size() };
+	return result;
+}
+
+} // namespace Soda
@@ -0,0 +1,36 @@
+#ifndef SODA_RELEXER_H
+#define SODA_RELEXER_H
+
+#include <soda/tokenlist.h>
+#include <cstddef>
+
+namespace Soda
+{
+
+// removed bytes at offset were replaced by inserted new ones
+struct TextEdit
+{
+	size_t offset, removed, inserted;
+	TextEdit(size_t offset=0, size_t removed=0, size_t inserted=0)
+		: offset(offset), removed(removed), inserted(inserted) {}
+};
+
+// What relex() did to the token list: removed tokens from first on were
+// replaced by inserted new ones, and the rest were moved along
+struct TokenEdit
+{
+	size_t first, removed, inserted;
+};
+
+// Bring tokens, from tokenize() on a buffer, up to date with an edit to it.
+// [begin, end) is the buffer after the edit, in UTF-8. Lexing restarts
+// from the token before the edit and stops as soon as it produces a token
+// that was there before (moved by the edit), since from then on nothing
+// changes. So the work lexing is in proportion to the edit rather than
+// the buffer, and the tokens after it are only spliced and shifted.
+TokenEdit relex(TokenList& tokens, const char *begin, const char *end,
+                const TextEdit& edit);
+
+} // namespace Soda
+
+#endif // SODA_RELEXER_H
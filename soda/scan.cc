@@ -0,0 +1,314 @@
+#include <soda/sodainc.h> // pch
+#include <soda/scan.h>
+#include <soda/cpudispatch.h>
+#include <cstdint>
+#include <cstring>
+
+namespace Soda
+{
+
+namespace
+{
+
+typedef const char *(*FindFunc)(const char*, const char*);
+typedef const char *(*FindEitherFunc)(const char*, const char*, char, char);
+
+const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+const char *find_non_ascii_scalar(const char *p, const char *end)
+{
+	while (end - p >= 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, p, sizeof(word));
+		if (word & HIGH_BITS)
+			break;
+		p += 8;
+	}
+	while (p < end && static_cast<unsigned char>(*p) < 0x80)
+		p++;
+	return p;
+}
+
+inline bool is_line_break_byte(unsigned char ch)
+{
+	return (ch >= 0x0A && ch <= 0x0D) || ch == 0xC2 || ch == 0xE2;
+}
+
+const char *find_line_break_scalar(const char *p, const char *end)
+{
+	while (p < end && !is_line_break_byte(*p))
+		p++;
+	return p;
+}
+
+const char *find_ascii_line_break_or_non_ascii_scalar(const char *p,
+                                                      const char *end)
+{
+	for (; p < end; p++)
+	{
+		unsigned char ch = *p;
+		if ((ch >= 0x0A && ch <= 0x0D) || ch >= 0x80)
+			break;
+	}
+	return p;
+}
+
+inline bool is_ascii_whitespace(unsigned char ch)
+{
+	return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+const char *skip_ascii_whitespace_scalar(const char *p, const char *end)
+{
+	while (p < end && is_ascii_whitespace(*p))
+		p++;
+	return p;
+}
+
+const char *find_either_or_non_ascii_scalar(const char *p, const char *end,
+                                           char a, char b)
+{
+	while (p < end && *p != a && *p != b &&
+	       static_cast<unsigned char>(*p) < 0x80)
+		p++;
+	return p;
+}
+
+#if SODA_X86
+
+__attribute__((target("sse2")))
+const char *find_non_ascii_sse2(const char *p, const char *end)
+{
+	while (end - p >= 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		int mask = _mm_movemask_epi8(v);
+		if (mask)
+			return p + __builtin_ctz(mask);
+		p += 16;
+	}
+	return find_non_ascii_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char *find_non_ascii_avx2(const char *p, const char *end)
+{
+	while (end - p >= 32)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		unsigned int mask = _mm256_movemask_epi8(v);
+		if (mask)
+			return p + __builtin_ctz(mask);
+		p += 32;
+	}
+	return find_non_ascii_sse2(p, end);
+}
+
+// Line break candidates are 0x0A-0x0D (tested as an unsigned range with
+// min/cmpeq since there's no unsigned byte compare) plus two lead bytes.
+
+__attribute__((target("sse2")))
+const char *find_line_break_sse2(const char *p, const char *end)
+{
+	const __m128i lo = _mm_set1_epi8(0x0A), span = _mm_set1_epi8(3);
+	const __m128i nel = _mm_set1_epi8(static_cast<char>(0xC2));
+	const __m128i lsps = _mm_set1_epi8(static_cast<char>(0xE2));
+	while (end - p >= 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i d = _mm_sub_epi8(v, lo);
+		__m128i hit = _mm_or_si128(
+			_mm_cmpeq_epi8(_mm_min_epu8(d, span), d),
+			_mm_or_si128(_mm_cmpeq_epi8(v, nel), _mm_cmpeq_epi8(v, lsps)));
+		int mask = _mm_movemask_epi8(hit);
+		if (mask)
+			return p + __builtin_ctz(mask);
+		p += 16;
+	}
+	return find_line_break_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char *find_line_break_avx2(const char *p, const char *end)
+{
+	const __m256i lo = _mm256_set1_epi8(0x0A), span = _mm256_set1_epi8(3);
+	const __m256i nel = _mm256_set1_epi8(static_cast<char>(0xC2));
+	const __m256i lsps = _mm256_set1_epi8(static_cast<char>(0xE2));
+	while (end - p >= 32)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i d = _mm256_sub_epi8(v, lo);
+		__m256i hit = _mm256_or_si256(
+			_mm256_cmpeq_epi8(_mm256_min_epu8(d, span), d),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, nel),
+			                _mm256_cmpeq_epi8(v, lsps)));
+		unsigned int mask = _mm256_movemask_epi8(hit);
+		if (mask)
+			return p + __builtin_ctz(mask);
+		p += 32;
+	}
+	return find_line_break_sse2(p, end);
+}
+
+// The same range test, with the top bit of each byte picked up straight
+// from the bytes by movemask
+
+__attribute__((target("sse2")))
+const char *find_ascii_line_break_or_non_ascii_sse2(const char *p,
+                                                    const char *end)
+{
+	const __m128i lo = _mm_set1_epi8(0x0A), span = _mm_set1_epi8(3);
+	while (end - p >= 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i d = _mm_sub_epi8(v, lo);
+		__m128i hit = _mm_or_si128(v,
+			_mm_cmpeq_epi8(_mm_min_epu8(d, span), d));
+		int mask = _mm_movemask_epi8(hit);
+		if (mask)
+			return p + __builtin_ctz(mask);
+		p += 16;
+	}
+	return find_ascii_line_break_or_non_ascii_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char *find_ascii_line_break_or_non_ascii_avx2(const char *p,
+                                                    const char *end)
+{
+	const __m256i lo = _mm256_set1_epi8(0x0A), span = _mm256_set1_epi8(3);
+	while (end - p >= 32)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i d = _mm256_sub_epi8(v, lo);
+		__m256i hit = _mm256_or_si256(v,
+			_mm256_cmpeq_epi8(_mm256_min_epu8(d, span), d));
+		unsigned int mask = _mm256_movemask_epi8(hit);
+		if (mask)
+			return p + __builtin_ctz(mask);
+		p += 32;
+	}
+	return find_ascii_line_break_or_non_ascii_sse2(p, end);
+}
+
+// Whitespace is 0x09-0x0D, tested like the line breaks above, or space.
+
+__attribute__((target("sse2")))
+const char *skip_ascii_whitespace_sse2(const char *p, const char *end)
+{
+	const __m128i lo = _mm_set1_epi8('\t'), span = _mm_set1_epi8(4);
+	const __m128i space = _mm_set1_epi8(' ');
+	while (end - p >= 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i d = _mm_sub_epi8(v, lo);
+		__m128i ws = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(d, span), d),
+		                          _mm_cmpeq_epi8(v, space));
+		int mask = ~_mm_movemask_epi8(ws) & 0xFFFF;
+		if (mask)
+			return p + __builtin_ctz(mask);
+		p += 16;
+	}
+	return skip_ascii_whitespace_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char *skip_ascii_whitespace_avx2(const char *p, const char *end)
+{
+	const __m256i lo = _mm256_set1_epi8('\t'), span = _mm256_set1_epi8(4);
+	const __m256i space = _mm256_set1_epi8(' ');
+	while (end - p >= 32)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i d = _mm256_sub_epi8(v, lo);
+		__m256i ws = _mm256_or_si256(
+			_mm256_cmpeq_epi8(_mm256_min_epu8(d, span), d),
+			_mm256_cmpeq_epi8(v, space));
+		unsigned int mask = ~static_cast<unsigned int>(_mm256_movemask_epi8(ws));
+		if (mask)
+			return p + __builtin_ctz(mask);
+		p += 32;
+	}
+	return skip_ascii_whitespace_sse2(p, end);
+}
+
+// A byte is a stop if it's either of the two or has its top bit set,
+// which movemask picks up straight from the bytes.
+
+__attribute__((target("sse2")))
+const char *find_either_or_non_ascii_sse2(const char *p, const char *end,
+                                          char a, char b)
+{
+	const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+	while (end - p >= 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i hit = _mm_or_si128(v, _mm_or_si128(_mm_cmpeq_epi8(v, va),
+		                                           _mm_cmpeq_epi8(v, vb)));
+		int mask = _mm_movemask_epi8(hit);
+		if (mask)
+			return p + __builtin_ctz(mask);
+		p += 16;
+	}
+	return find_either_or_non_ascii_scalar(p, end, a, b);
+}
+
+__attribute__((target("avx2")))
+const char *find_either_or_non_ascii_avx2(const char *p, const char *end,
+                                          char a, char b)
+{
+	const __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b);
+	while (end - p >= 32)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i hit = _mm256_or_si256(v, _mm256_or_si256(
+			_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+		unsigned int mask = _mm256_movemask_epi8(hit);
+		if (mask)
+			return p + __builtin_ctz(mask);
+		p += 32;
+	}
+	return find_either_or_non_ascii_sse2(p, end, a, b);
+}
+
+#endif // SODA_X86
+
+const FindFunc find_non_ascii_impl = SELECT(find_non_ascii);
+const FindFunc find_line_break_impl = SELECT(find_line_break);
+const FindFunc skip_ascii_whitespace_impl = SELECT(skip_ascii_whitespace);
+const FindFunc find_ascii_line_break_or_non_ascii_impl =
+	SELECT(find_ascii_line_break_or_non_ascii);
+const FindEitherFunc find_either_or_non_ascii_impl =
+	SELECT(find_either_or_non_ascii);
+
+} // anonymous namespace
+
+const char *find_non_ascii(const char *begin, const char *end)
+{
+	return find_non_ascii_impl(begin, end);
+}
+
+const char *find_line_break(const char *begin, const char *end)
+{
+	return find_line_break_impl(begin, end);
+}
+
+const char *find_ascii_line_break_or_non_ascii(const char *begin,
+                                               const char *end)
+{
+	return find_ascii_line_break_or_non_ascii_impl(begin, end);
+}
+
+const char *skip_ascii_whitespace(const char *begin, const char *end)
+{
+	return skip_ascii_whitespace_impl(begin, end);
+}
+
+const char *find_either_or_non_ascii(const char *begin, const char *end,
+                                     char a, char b)
+{
+	return find_either_or_non_ascii_impl(begin, end, a, b);
+}
+
+} // namespace Soda
@@ -0,0 +1,35 @@
+#ifndef SODA_SCAN_H
+#define SODA_SCAN_H
+
+namespace Soda
+{
+
+// Byte scanning kernels used by the input and lexer hot loops. Each one is
+// vectorized with the widest instruction set the CPU supports (AVX2 or
+// SSE2), selected once at startup, with a portable fallback.
+
+// Find the first byte in [begin, end) that isn't 7-bit ASCII, or end.
+const char *find_non_ascii(const char *begin, const char *end);
+
+// Find the first byte in [begin, end) that may start a line break (LF, VT,
+// FF, CR or the lead byte of NEL, LS and PS), or end. Multibyte candidates
+// still have to be checked by the caller.
+const char *find_line_break(const char *begin, const char *end);
+
+// Find the first byte in [begin, end) that is an ASCII line break (LF, VT,
+// FF or CR) or isn't 7-bit ASCII, or end
+const char *find_ascii_line_break_or_non_ascii(const char *begin,
+                                               const char *end);
+
+// Find the first byte in [begin, end) that isn't ASCII whitespace (tab,
+// LF, VT, FF, CR or space), or end.
+const char *skip_ascii_whitespace(const char *begin, const char *end);
+
+// Find the first byte in [begin, end) that is a or b, or isn't 7-bit
+// ASCII, or end. a and b must be ASCII (they may be the same).
+const char *find_either_or_non_ascii(const char *begin, const char *end,
+                                     char a, char b);
+
+} // namespace Soda
+
+#endif // SODA_SCAN_H
@@ -0,0 +1,86 @@
+#include <soda/sodainc.h> // pch
+#include <soda/sourcebuffer.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Soda
+{
+
+SourceBuffer::SourceBuffer(const char *data, size_t size)
+	: buf(data), len(size), mapping(nullptr), opened(true)
+{
+}
+
+SourceBuffer::SourceBuffer(std::unique_ptr<char[]> data, size_t size)
+	: buf(data.get()), len(size), mapping(nullptr), owned(std::move(data)),
+	  opened(true)
+{
+}
+
+SourceBuffer::SourceBuffer(std::string&& text)
+	: buf(nullptr), len(text.size()), mapping(nullptr), storage(std::move(text)),
+	  opened(true)
+{
+	buf = storage.data();
+}
+
+SourceBuffer::SourceBuffer(const std::string& filename)
+	: buf(nullptr), len(0), mapping(nullptr), opened(false)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		buf = storage.data();
+		return;
+	}
+	opened = map_file(fd) || read_file(fd);
+	::close(fd);
+	if (!mapping)
+		buf = storage.data();
+}
+
+SourceBuffer::~SourceBuffer()
+{
+	if (mapping)
+		::munmap(mapping, len);
+}
+
+// Map regular, non-empty files directly
+bool SourceBuffer::map_file(int fd)
+{
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+		return false;
+	void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED)
+		return false;
+	::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+	mapping = addr;
+	buf = static_cast<const char*>(addr);
+	len = st.st_size;
+	return true;
+}
+
+// Fallback for files that can't be mapped
+bool SourceBuffer::read_file(int fd)
+{
+	char chunk[64 * 1024];
+	ssize_t n;
+	while ((n = ::read(fd, chunk, sizeof(chunk))) != 0)
+	{
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		storage.append(chunk, n);
+	}
+	len = storage.size();
+	return true;
+}
+
+} // namespace Soda
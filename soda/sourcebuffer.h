@@ -0,0 +1,47 @@
+#ifndef SODA_SOURCEBUFFER_H
+#define SODA_SOURCEBUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace Soda
+{
+
+// A contiguous, read-only block of source text. Regular files are
+// memory-mapped, anything else (pipes, devices, empty files) is read into
+// owned storage. Wrapped caller memory is not copied and must outlive the
+// buffer.
+class SourceBuffer
+{
+public:
+	SourceBuffer(const char *data, size_t size);
+	// Take over data, eg. the result of transcoding another buffer
+	SourceBuffer(std::unique_ptr<char[]> data, size_t size);
+	SourceBuffer(std::string&& text);
+	SourceBuffer(const std::string& filename);
+	~SourceBuffer();
+
+	const char *begin() const { return buf; }
+	const char *end() const { return buf + len; }
+	size_t size() const { return len; }
+	bool is_open() const { return opened; }
+
+private:
+	const char *buf;
+	size_t len;
+	void *mapping;
+	std::string storage;
+	std::unique_ptr<char[]> owned;
+	bool opened;
+
+	bool map_file(int fd);
+	bool read_file(int fd);
+
+	SourceBuffer(const SourceBuffer&);
+	SourceBuffer& operator=(const SourceBuffer&);
+};
+
+} // namespace Soda
+
+#endif // SODA_SOURCEBUFFER_H
@@ -1,6 +1,9 @@
 #ifndef SODA_SOURCELOCATION_H
 #define SODA_SOURCELOCATION_H
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <ostream>
 
 namespace Soda
@@ -13,6 +16,8 @@ struct SourceRange
 	SourceRange() : start(0), end(0) {}
 };
 
+// A resolved position, line and column are zero-based and the column is
+// counted in code points. See SourceManager::position().
 struct SourcePosition
 {
 	size_t offset, line, column;
@@ -28,31 +33,25 @@ struct SourcePosition
 	}
 };
 
+// The half-open byte range [start, end) covered by a token or node, as
+// offsets into a SourceManager's location space. Kept to 32 bits a side
+// since every token and node carries one; the file, line and column are
+// only computed when something needs to print them.
 struct SourceLocation
 {
-	SourceRange offset, line, column;
-	SourceLocation(size_t offset_start=0, size_t offset_end=0,
-	               size_t line_start=0,   size_t line_end=0,
-	               size_t column_start=0, size_t column_end=0)
-		: offset(offset_start, offset_end),
-		  line(line_start, line_end),
-		  column(column_start, column_end) {}
-	SourceLocation(const SourcePosition& start, const SourcePosition& end)
+	uint32_t offset, length;
+	SourceLocation(size_t start=0, size_t end=0)
+		: offset(start), length(end - start)
 	{
-		offset.start = start.offset;
-		offset.end = end.offset;
-		line.start = start.line;
-		line.end = end.line;
-		column.start = start.column;
-		column.end = end.column;
+		assert(start <= end);
 	}
-	SourcePosition start()  const
+	size_t start() const { return offset; }
+	size_t end() const { return size_t(offset) + length; }
+	void set_start(size_t start) { offset = start; }
+	void set_end(size_t end)
 	{
-		return SourcePosition(offset.start, line.start, column.start);
-	}
-	SourcePosition end() const
-	{
-		return SourcePosition(offset.end, line.end, column.end);
+		assert(end >= offset);
+		length = end - offset;
 	}
 };
 
@@ -0,0 +1,140 @@
+#include <soda/sodainc.h> // pch
+#include <soda/sourcemanager.h>
+#include <soda/utils.h>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace Soda
+{
+
+static const size_t MAX_OFFSET = std::numeric_limits<uint32_t>::max();
+
+SourceManager::SourceManager()
+{
+}
+
+// Files are laid out one after the other, each followed by the offset of
+// its END token
+SourceFile& SourceManager::add(const std::string& name, size_t size)
+{
+	size_t base = 0;
+	if (!entries.empty())
+		base = entries.back()->base + entries.back()->size + 1;
+	if (base > MAX_OFFSET || size > MAX_OFFSET - base)
+		throw std::length_error("source files exceed 4 GiB of locations");
+	entries.emplace_back(new SourceFile(name, base));
+	entries.back()->size = size;
+	return *entries.back();
+}
+
+// Transcoded to UTF-8 first if need be
+SourceFile& SourceManager::add_file(const std::string& name,
+                                    std::unique_ptr<SourceBuffer> buffer)
+{
+	DiagnosticList guessed;
+	Encoding enc = detect_encoding(buffer->begin(), buffer->end(), guessed);
+	if (enc != ENC_UTF8)
+	{
+		std::unique_ptr<char[]> text(
+			new char[utf8_size_bound(enc, buffer->size())]);
+		char *end = transcode_to_utf8(enc, buffer->begin(), buffer->end(),
+		                              text.get());
+		size_t size = end - text.get();
+		buffer.reset(new SourceBuffer(std::move(text), size));
+	}
+	SourceFile& file = add(name, buffer->size());
+	file.encoding = enc;
+	file.diagnostics.swap(guessed);
+	file.buffer = std::move(buffer);
+	file.lines.scan(file.buffer->begin(), file.buffer->end());
+	return file;
+}
+
+SourceFile *SourceManager::add_file(const std::string& filename)
+{
+	std::unique_ptr<SourceBuffer> buf(new SourceBuffer(filename));
+	if (!buf->is_open())
+		return nullptr;
+	return &add_file(filename, std::move(buf));
+}
+
+SourceFile& SourceManager::add_buffer(const std::string& name,
+                                      const char *data, size_t size)
+{
+	return add_file(name,
+		std::unique_ptr<SourceBuffer>(new SourceBuffer(data, size)));
+}
+
+SourceFile& SourceManager::add_stream(const std::string& name)
+{
+	return add(name, 0);
+}
+
+const SourceFile *SourceManager::file(size_t offset) const
+{
+	auto it = std::upper_bound(entries.begin(), entries.end(), offset,
+		[](size_t off, const std::unique_ptr<SourceFile>& f)
+		{ return off < f->base; });
+	if (it == entries.begin())
+		return nullptr;
+	return (--it)->get();
+}
+
+const std::string& SourceManager::filename(size_t offset) const
+{
+	static const std::string none;
+	const SourceFile *f = file(offset);
+	return f ? f->name : none;
+}
+
+// Resolve an offset in file. The line table only knows where lines start,
+// so the column is counted here in code points from the file's text, like
+// the lexer reads it (the invisible ones it skips don't count). A stream
+// whose text wasn't kept only has a column in bytes.
+static SourcePosition resolve(const SourceFile& file, size_t offset)
+{
+	SourcePosition pos = file.lines.position(offset);
+	if (!file.buffer || offset > file.buffer->size())
+		return pos;
+	const char *end = file.buffer->begin() + offset;
+	const char *p = end - pos.column;
+	size_t column = 0;
+	while (p < end)
+	{
+		char32_t cp;
+		decode_utf8(p, end, cp);
+		if (cp != U'\uFEFF' && cp != U'\u2060')
+			column++;
+	}
+	pos.column = column;
+	return pos;
+}
+
+SourcePosition SourceManager::position(size_t offset) const
+{
+	const SourceFile *f = file(offset);
+	if (!f)
+		return SourcePosition(offset);
+	return resolve(*f, offset - f->base);
+}
+
+std::u32string SourceManager::text(SourceLocation loc) const
+{
+	const SourceFile *f = file(loc.start());
+	if (!f || !f->buffer)
+		return std::u32string();
+	const char *start = f->buffer->begin() + (loc.start() - f->base);
+	return utf8_decode(start, start + loc.length);
+}
+
+void format_diagnostic(std::ostream& stream, const SourceFile& file,
+                       const Diagnostic& diag)
+{
+	SourcePosition pos = resolve(file, diag.offset);
+	stream << "\x1B[35mwarning\x1B[0m:\x1B[33m" << file.name << "\x1B[0m:";
+	stream << "\x1B[35m" << pos.line + 1 << "\x1B[0m:";
+	stream << "\x1B[36m" << pos.column + 1 << "\x1B[0m: " << diag.message << "\n";
+}
+
+} // namespace Soda
@@ -0,0 +1,81 @@
+#ifndef SODA_SOURCEMANAGER_H
+#define SODA_SOURCEMANAGER_H
+
+#include <soda/diagnostic.h>
+#include <soda/encoding.h>
+#include <soda/linetable.h>
+#include <soda/sourcebuffer.h>
+#include <soda/sourcelocation.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Soda
+{
+
+// A file known to a SourceManager. Its bytes occupy the offsets
+// [base, base + size) of the manager's location space, and the offset
+// just past the end is reserved for the file's END token. Files that
+// aren't UTF-8 are transcoded when they're added, offsets then refer to
+// the UTF-8 text.
+struct SourceFile
+{
+	std::string name;
+	uint32_t base;
+	size_t size; // filled in by the lexer for streamed files
+	Encoding encoding; // of the file on disk
+	LineTable lines; // file-relative offsets
+	DiagnosticList diagnostics; // from lexing the file
+	std::unique_ptr<SourceBuffer> buffer; // null for streams until lexed
+	SourceFile(const std::string& name, uint32_t base)
+		: name(name), base(base), size(0), encoding(ENC_UTF8) {}
+};
+
+// Owns the source files of a compilation and gives each of them a base
+// offset so that a SourceLocation can refer to any of them in 32 bits.
+// Locations are only turned back into file/line/column here, when a
+// diagnostic or dump needs them.
+class SourceManager
+{
+public:
+	SourceManager();
+
+	// Load filename, returns nullptr if it can't be opened
+	SourceFile *add_file(const std::string& filename);
+	// Register an already loaded file, eg. from a FileLoader
+	SourceFile& add_file(const std::string& filename,
+	                     std::unique_ptr<SourceBuffer> buffer);
+	// Register caller memory, which must outlive the manager
+	SourceFile& add_buffer(const std::string& name,
+	                       const char *data, size_t size);
+	// Register a file that will be lexed from a stream, its size is only
+	// known once the lexer reaches the end
+	SourceFile& add_stream(const std::string& name);
+
+	size_t files() const { return entries.size(); }
+	const SourceFile& file_at(size_t index) const { return *entries[index]; }
+	const SourceFile *file(size_t offset) const;
+	const std::string& filename(size_t offset) const;
+	// Line and column of offset, the position's offset is file-relative
+	SourcePosition position(size_t offset) const;
+	// The source text at loc, decoded (see utf8_decode())
+	std::u32string text(SourceLocation loc) const;
+
+private:
+	std::vector<std::unique_ptr<SourceFile>> entries;
+	SourceFile& add(const std::string& name, size_t size);
+
+	SourceManager(const SourceManager&);
+	SourceManager& operator=(const SourceManager&);
+};
+
+// Print diag as a warning located in file
+void format_diagnostic(std::ostream& stream, const SourceFile& file,
+                       const Diagnostic& diag);
+
+} // namespace Soda
+
+#endif // SODA_SOURCEMANAGER_H
@@ -1,7 +1,15 @@
 #include <soda/sodainc.h> // pch
+#include <soda/fileloader.h>
 #include <soda/input.h>
+#include <soda/scan.h>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
 #include <sstream>
+#include <unistd.h>
 #include <cassert>
+#include <vector>
+#include <utf8/utf8.h>
 
 using namespace Soda;
 
@@ -10,61 +18,385 @@ struct Test
 	const char *str;
 	size_t len;
 	char32_t last;
-	size_t pos;
-	size_t line;
-	size_t col;
+	size_t offset; // byte offset of the code point
+	size_t line;   // its zero-based line
+	size_t col;    // and column, in bytes
 };
 
 static const Test tests[] = {
-	{ u8"a",       1, U'a',       1,  0,  1 }, // 1. whatever letter
-	{ u8" ",       1, U' ',       2,  0,  2 }, // 2. normal space
-	{ u8"\t",      1, U'\t',      3,  0,  3 }, // 3. tabs
-	{ u8"\0",      1, U'\0',      4,  0,  4 }, // 4. \0 is treated like any other codepoint
-	{ u8"\n",      1, U'\n',      5,  1,  0 }, // 5. Line feed
-	{ u8"\v",      1, U'\v',      6,  2,  0 }, // 6. Vertical tab
-	{ u8"\f",      1, U'\f',      7,  3,  0 }, // 7. Form feed
-	{ u8"\r",      1, U'\r',      8,  4,  0 }, // 8. Carriage return
-	{ u8"\u0085",  2, U'\u0085',  9,  5,  0 }, // 9. Next line
-	{ u8"\u2028",  3, U'\u2028',  10, 6,  0 }, // 10. Line separator
-	{ u8"\u2029",  3, U'\u2029',  11, 7,  0 }, // 11. Paragraph separator
-	{ u8"\r\n",    2, U'\n',      13, 8,  0 }, // 12. Carriage return and line feed (CRLF)
+	{ u8"a",       1, U'a',       0,  0,  0 }, // 1. whatever letter
+	{ u8" ",       1, U' ',       1,  0,  1 }, // 2. normal space
+	{ u8"\t",      1, U'\t',      2,  0,  2 }, // 3. tabs
+	{ u8"\0",      1, U'\0',      3,  0,  3 }, // 4. \0 is treated like any other codepoint
+	{ u8"\n",      1, U'\n',      4,  0,  4 }, // 5. Line feed
+	{ u8"\v",      1, U'\v',      5,  1,  0 }, // 6. Vertical tab
+	{ u8"\f",      1, U'\f',      6,  2,  0 }, // 7. Form feed
+	{ u8"\r",      1, U'\r',      7,  3,  0 }, // 8. Carriage return
+	{ u8"\u0085",  2, U'\u0085',  8,  4,  0 }, // 9. Next line
+	{ u8"\u2028",  3, U'\u2028',  10, 5,  0 }, // 10. Line separator
+	{ u8"\u2029",  3, U'\u2029',  13, 6,  0 }, // 11. Paragraph separator
+	{ u8"\r\n",    2, U'\n',      17, 7,  1 }, // 12. Carriage return and line feed (CRLF)
 };
 
 static const size_t n_tests = sizeof(tests) / sizeof(tests[0]);
 
-int main()
+static void check(Input& inp, const LineTable& lines)
 {
-	std::stringstream ss;
-
-	// Load up the input stream before passing to Input constructor
-	//ss.write(u8"\uFEFF", 3);
-	//ss.write(u8"\u2060", 3);
-	for (size_t i = 0; i < n_tests; i++)
-		ss.write(tests[i].str, tests[i].len);
-
-	Input inp(ss);
-
 	// Initial state
 	assert(inp.last == 0);
 	assert(inp.peek() != Input::END);
-	assert(inp.position == SourcePosition(0,0,0));
+	assert(inp.offset == 0);
 
 	// Tests
 	for (size_t i = 0; i < n_tests; i++)
 	{
 		inp.next();
 		assert(inp.last == tests[i].last);
-		assert(inp.position ==
-			SourcePosition(tests[i].pos, tests[i].line, tests[i].col));
+		assert(inp.offset == tests[i].offset);
+		assert(lines.position(inp.offset) ==
+			SourcePosition(tests[i].offset, tests[i].line, tests[i].col));
 	}
 
 	// EOF
 	inp.next();
 	assert(inp.last == Input::END);
 	assert(inp.peek() == Input::END);
-	assert(inp.position ==
-		SourcePosition(tests[n_tests - 1].pos, tests[n_tests - 1].line,
-			tests[n_tests - 1].col));
+	assert(inp.offset == tests[n_tests - 1].offset + 1);
+	assert(lines.lines() == tests[n_tests - 1].line + 2);
+	assert(lines.position(inp.offset) ==
+		SourcePosition(inp.offset, tests[n_tests - 1].line + 1, 0));
+}
+
+// Exercise the vectorized kernels across their block boundaries
+static void check_scan()
+{
+	std::string buf(100, 'x');
+	for (size_t len = 0; len <= buf.size(); len++)
+	{
+		const char *begin = buf.data(), *end = begin + len;
+		(void)end; // prevent warning in ndebug mode
+		assert(find_non_ascii(begin, end) == end);
+		for (size_t i = 0; i < len; i++)
+		{
+			buf[i] = '\xC3';
+			assert(find_non_ascii(begin, end) == begin + i);
+			buf[i] = 'x';
+		}
+	}
+}
+
+// Streams are read through a small window, which splits code points and
+// line breaks across chunks; they should decode exactly like a buffer.
+static void check_stream(const std::string& text)
+{
+	for (size_t window = 4; window <= 32; window++)
+	{
+		LineTable buf_lines, stream_lines;
+		Input buf_inp(text.data(), text.data() + text.size(), &buf_lines);
+		std::stringstream ss(text);
+		Input stream_inp(ss, &stream_lines, window);
+		do
+		{
+			buf_inp.next();
+			stream_inp.next();
+			assert(stream_inp.last == buf_inp.last);
+			assert(stream_inp.offset == buf_inp.offset);
+		}
+		while (buf_inp.last != Input::END);
+		assert(stream_lines.lines() == buf_lines.lines());
+		for (size_t i = 0; i <= text.size(); i++)
+			assert(stream_lines.position(i) == buf_lines.position(i));
+	}
+}
+
+static std::string transcode(Encoding enc, const std::string& str)
+{
+	std::unique_ptr<char[]> out(new char[utf8_size_bound(enc, str.size())]);
+	char *end = transcode_to_utf8(enc, str.data(), str.data() + str.size(),
+	                              out.get());
+	return std::string(out.get(), end);
+}
+
+static std::string to_utf16(const std::u32string& str, bool big_endian)
+{
+	std::u16string units;
+	for (char32_t ch : str)
+	{
+		if (ch >= 0x10000)
+		{
+			units += 0xD800 + ((ch - 0x10000) >> 10);
+			units += 0xDC00 + ((ch - 0x10000) & 0x3FF);
+		}
+		else
+			units += ch;
+	}
+	std::string bytes;
+	for (char16_t u : units)
+	{
+		char hi = u >> 8, lo = u & 0xFF;
+		bytes += big_endian ? hi : lo;
+		bytes += big_endian ? lo : hi;
+	}
+	return bytes;
+}
+
+// Transcode mixed text of every length across the kernels' blocks and
+// compare with the reference conversion
+static void check_transcode()
+{
+	static const char32_t mix[] = { U'x', U'\u00E9', U'y', U'\u2014', U'z',
+	                                U'\U0001F600', U' ' };
+	for (size_t len = 0; len <= 100; len++)
+	{
+		std::u32string str, ascii(len, U'a');
+		for (size_t i = 0; i < len; i++)
+			str += (i % 9 == 8) ? mix[(len + i) % 7] : U'a' + (i % 26);
+		std::string expected;
+		utf8::utf32to8(str.begin(), str.end(), std::back_inserter(expected));
+		for (int be = 0; be < 2; be++)
+		{
+			std::string bytes = to_utf16(str, be);
+			std::string out = transcode(be ? ENC_UTF16BE : ENC_UTF16LE, bytes);
+			assert(out == expected);
+		}
+
+		std::string latin1, latin1_expected;
+		for (size_t i = 0; i < len; i++)
+		{
+			char32_t ch = (i % 5 == 4) ? 0xA0 + (len + i) % 0x60 : U'a' + (i % 26);
+			latin1 += static_cast<char>(ch);
+			utf8::append(ch, std::back_inserter(latin1_expected));
+		}
+		std::string out = transcode(ENC_LATIN1, latin1);
+		assert(out == latin1_expected);
+	}
+
+	// an unpaired surrogate and an odd trailing byte are replaced
+	std::string bad("\x3D\xD8\x41\x00\x42", 5);
+	std::string out = transcode(ENC_UTF16LE, bad);
+	assert(out == u8"\uFFFDA\uFFFD");
+}
+
+static void check_detect()
+{
+	static const struct
+	{
+		std::string str;
+		Encoding enc;
+	} tests[] = {
+		{ "", ENC_UTF8 },
+		{ "int x;", ENC_UTF8 },
+		{ u8"\uFEFFint x;", ENC_UTF8 },
+		{ u8"caf\u00E9", ENC_UTF8 },
+		{ "caf\xE9", ENC_LATIN1 },
+		{ u8"caf\u00E9 na\u00EFve\xFF", ENC_UTF8 },
+		{ "\xFF\xFEi", ENC_UTF16LE },
+		{ "\xFE\xFF", ENC_UTF16BE },
+		{ to_utf16(U"int x;", false), ENC_UTF16LE },
+		{ to_utf16(U"int x;", true), ENC_UTF16BE },
+	};
+	for (auto& test : tests)
+	{
+		Encoding enc = detect_encoding(test.str.data(),
+		                               test.str.data() + test.str.size());
+		assert(enc == test.enc);
+		// only the guess at ISO-8859-1 is remarked on
+		DiagnosticList diags;
+		enc = detect_encoding(test.str.data(),
+		                      test.str.data() + test.str.size(), diags);
+		assert(enc == test.enc);
+		assert(diags.size() == (enc == ENC_LATIN1 ? 1u : 0u));
+		(void)enc;
+	}
+}
+
+// Peeking k ahead sees what the k-th next() will return, and doesn't
+// change what's consumed
+static void check_peek(const std::string& text, size_t window)
+{
+	const char *begin = text.data(), *end = begin + text.size();
+	std::vector<char32_t> all;
+	std::vector<size_t> offsets;
+	Input ref(begin, end);
+	do
+	{
+		all.push_back(ref.next());
+		offsets.push_back(ref.offset);
+	}
+	while (ref.last != Input::END);
+
+	std::stringstream ss(text);
+	Input buf_inp(begin, end), stream_inp(ss, nullptr, window);
+	for (Input *inp : { &buf_inp, &stream_inp })
+	{
+		for (size_t i = 0; i < all.size(); i++)
+		{
+			size_t k = (i % Input::LOOKAHEAD) + 1;
+			for (size_t j = 1; j <= k; j++)
+			{
+				char32_t ch = inp->peek(j);
+				(void)ch;
+				assert(ch == (i + j - 1 < all.size() ? all[i + j - 1] : Input::END));
+			}
+			assert(inp->next() == all[i]);
+			assert(inp->offset == offsets[i]);
+		}
+	}
+}
+
+// Malformed UTF-8 decodes as U+FFFD, one per maximal bad subpart, with a
+// diagnostic at each one's offset
+static const char bad_text[] =
+	"\xEF\xBB\xBF" "a" "\xC3(" "\xE0\x80\xAF" "\xED\xA0\x80"
+	"\xF0\x9F\x98" "x" "\xF0\x9F\x98\x80" "\xFF" "\xE2\x82";
+
+static void check_invalid(Input& inp)
+{
+	static const char32_t expected[] = {
+		U'a', 0xFFFD, U'(', 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD,
+		0xFFFD, U'x', 0x1F600, 0xFFFD, 0xFFFD, Input::END
+	};
+	static const size_t bad[] = { 4, 6, 7, 8, 9, 10, 11, 12, 20, 21 };
+	static const size_t n_bad = sizeof(bad) / sizeof(bad[0]);
+
+	assert(inp.encoding == ENC_UTF8);
+	for (char32_t ch : expected)
+	{
+		assert(inp.next() == ch);
+		(void)ch;
+	}
+	assert(inp.offset == sizeof(bad_text) - 1);
+	assert(inp.diagnostics.size() == n_bad);
+	for (size_t i = 0; i < n_bad; i++)
+		assert(inp.diagnostics[i].offset == bad[i]);
+}
+
+// Files of assorted sizes, including ones bigger than a single read, load
+// the same way with io_uring (where available) and with the thread pool
+static void check_loader()
+{
+	std::vector<std::string> names, contents;
+	for (size_t size : { 1, 4095, 4096, 65537, 5 * 1024 * 1024 + 3 })
+	{
+		char name[] = "/tmp/test_input_XXXXXX";
+		int fd = mkstemp(name);
+		assert(fd >= 0);
+		close(fd);
+		std::string text(size, 0);
+		for (size_t i = 0; i < size; i++)
+			text[i] = 'a' + (i * 7 + size) % 26;
+		std::ofstream(name, std::ios::binary) << text;
+		names.push_back(name);
+		contents.push_back(text);
+	}
+	names.push_back("/nonexistent/test_input");
+	contents.push_back("");
+
+	for (auto method : { FileLoader::LOAD_AUTO, FileLoader::LOAD_THREADS })
+	{
+		FileLoader loader(names, method);
+		assert(loader.size() == names.size());
+		for (size_t i = names.size(); i-- > 0; ) // not in loading order
+		{
+			std::unique_ptr<SourceBuffer> buf = loader.take(i);
+			if (i == names.size() - 1)
+				assert(!buf);
+			else
+				assert(buf && std::string(buf->begin(), buf->end()) == contents[i]);
+		}
+	}
+
+	// io_uring that's busy for a while, that refuses every read, and that
+	// gives up after taking the first ones (the big file needing a second)
+	// all still load every file
+	struct Failure { int error; unsigned pass; int count; };
+	for (Failure failure : { Failure{EAGAIN, 0, 3}, Failure{EBUSY, 1, 2},
+	                         Failure{EIO, 0, -1}, Failure{EIO, 1, -1} })
+	{
+		fail_io_uring_submits(failure.error, failure.pass, failure.count);
+		FileLoader loader(names);
+		for (size_t i = 0; i < names.size() - 1; i++)
+		{
+			std::unique_ptr<SourceBuffer> buf = loader.take(i);
+			assert(buf && std::string(buf->begin(), buf->end()) == contents[i]);
+		}
+		assert(!loader.take(names.size() - 1));
+	}
+	fail_io_uring_submits(0, 0, 0);
+
+	for (size_t i = 0; i < names.size() - 1; i++)
+		std::remove(names[i].c_str());
+}
+
+int main()
+{
+	check_scan();
+	check_transcode();
+	check_detect();
+	check_loader();
+
+	Input bad_inp(bad_text, bad_text + sizeof(bad_text) - 1);
+	check_invalid(bad_inp);
+	for (size_t window = 4; window <= 16; window++)
+	{
+		std::stringstream bad_ss(std::string(bad_text, sizeof(bad_text) - 1));
+		Input bad_stream_inp(bad_ss, nullptr, window);
+		check_invalid(bad_stream_inp);
+	}
+
+	std::stringstream ss;
+
+	// Load up the input stream before passing to Input constructor
+	//ss.write(u8"\uFEFF", 3);
+	//ss.write(u8"\u2060", 3);
+	for (size_t i = 0; i < n_tests; i++)
+		ss.write(tests[i].str, tests[i].len);
+
+	// Buffer backed input
+	std::string buf(ss.str());
+	LineTable buf_lines;
+	Input buf_inp(buf.data(), buf.data() + buf.size(), &buf_lines);
+	check(buf_inp, buf_lines);
+
+	// Stream backed input
+	LineTable stream_lines;
+	Input stream_inp(ss, &stream_lines);
+	check(stream_inp, stream_lines);
+
+	check_stream(buf + buf + buf);
+	for (size_t window = 4; window <= 8; window++)
+		check_peek(buf + buf + buf, window);
+
+	// UTF-16 decodes to the same code points, offsets are into the
+	// transcoded text
+	std::u32string str32;
+	utf8::utf8to32(buf.begin(), buf.end(), std::back_inserter(str32));
+	std::string utf16 = "\xFF\xFE" + to_utf16(str32, false);
+	LineTable utf16_lines;
+	Input utf16_inp(utf16.data(), utf16.data() + utf16.size(), &utf16_lines);
+	assert(utf16_inp.encoding == ENC_UTF16LE);
+	check(utf16_inp, utf16_lines);
+	std::stringstream utf16_ss(utf16);
+	LineTable utf16_stream_lines;
+	Input utf16_stream_inp(utf16_ss, &utf16_stream_lines, 16);
+	assert(utf16_stream_inp.encoding == ENC_UTF16LE);
+	check(utf16_stream_inp, utf16_stream_lines);
+
+	std::string latin1("caf\xE9\n");
+	Input latin1_inp(latin1.data(), latin1.data() + latin1.size());
+	assert(latin1_inp.encoding == ENC_LATIN1);
+	for (char32_t ch : U"caf\u00E9\n")
+	{
+		assert(latin1_inp.next() == (ch ? ch : Input::END));
+		(void)ch;
+	}
+	assert(latin1_inp.diagnostics.size() == 1);
+	assert(latin1_inp.diagnostics[0].offset == 3);
+	std::stringstream latin1_ss(latin1);
+	Input latin1_stream_inp(latin1_ss, nullptr, 16);
+	assert(latin1_stream_inp.encoding == ENC_LATIN1);
+	assert(latin1_stream_inp.diagnostics.size() == 1);
+	assert(latin1_stream_inp.diagnostics[0].offset == 3);
 
 	return 0;
 
@@ -1,6 +1,15 @@
 #include <soda/sodainc.h> // pch
+#include <soda/highlighter.h>
 #include <soda/lexer.h>
+#include <soda/parallellexer.h>
+#include <soda/relexer.h>
+#include <soda/tokenstream.h>
+#include <soda/utils.h>
 #include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 #include <cassert>
 
 using namespace Soda;
@@ -12,13 +21,730 @@ using namespace Soda;
 		ss << inp_text_;                                          \
 		k = lex.next();                                           \
 		/*std::cout << "Kind: " << k << std::endl;*/              \
-		/*std::cout << "Text: " << lex.token.text << std::endl;*/ \
+		/*std::cout << "Text: " << lex.text(lex.token) << std::endl;*/ \
 		assert(k == Token::tok);                                  \
-		assert(lex.token.text == str_check);                      \
+		assert(lex.text(lex.token) == str_check);                 \
 	} while (0)
 
+// Tokens from several files share one location space and resolve back to
+// the right file, line and column
+static void check_sources()
+{
+	static const char a[] = "foo bar\nbaz";
+	static const char b[] = "x\n  y";
+	SourceManager sm;
+	std::stringstream ss("s1\ns2");
+
+	TokenList ta = tokenize(sm.add_buffer("a.soda", a, sizeof(a) - 1));
+	TokenList tc = tokenize(sm.add_stream("<stdin>"), ss);
+	TokenList tb = tokenize(sm.add_buffer("b.soda", b, sizeof(b) - 1));
+	assert(sm.files() == 3);
+	assert(ta.size() == 3 && tb.size() == 2 && tc.size() == 2);
+
+	SourcePosition p = sm.position(ta[2].location.start());
+	assert(sm.filename(ta[2].location.start()) == "a.soda");
+	assert(p.line == 1 && p.column == 0);
+	assert(ta[2].location.end() - ta[2].location.start() == 3);
+
+	p = sm.position(tc[1].location.start());
+	assert(sm.filename(tc[1].location.start()) == "<stdin>");
+	assert(p.line == 1 && p.column == 0);
+	assert(tc[1].location.start() > ta[2].location.end());
+
+	p = sm.position(tb[1].location.start());
+	assert(sm.filename(tb[1].location.start()) == "b.soda");
+	assert(p.line == 1 && p.column == 2);
+	assert(tb[0].location.start() > tc[1].location.end());
+
+	// token text is decoded from the files on demand, streams included
+	assert(sm.text(ta[1].location) == U"bar");
+	assert(sm.text(tc[1].location) == U"s2");
+	assert(sm.text(tb[1].location) == U"y");
+
+	assert(sizeof(SourceLocation) == 8);
+
+	// a guess at ISO-8859-1 is kept on the file through lexing it
+	static const char c[] = "caf\xE9 \xFF";
+	SourceFile& fc = sm.add_buffer("c.soda", c, sizeof(c) - 1);
+	TokenList td = tokenize(fc);
+	assert(fc.encoding == ENC_LATIN1);
+	assert(fc.diagnostics.size() == 1 && fc.diagnostics[0].offset == 3);
+	assert(td.size() == 2 && sm.text(td[0].location) == U"caf\u00E9");
+	(void)p;
+	(void)td;
+}
+
+// Text comes back the way the lexer read it, without the delimiters
+static void check_text()
+{
+	static const char src[] = "\"a\r\nb\" 0x1F name '\xFF' \"\xC3\xAF\"";
+	SourceManager sm;
+	TokenList toks = tokenize(sm.add_buffer("t.soda", src, sizeof(src) - 1));
+	assert(toks.size() == 5);
+	assert(sm.text(toks[0].location) == U"a\nb");
+	assert(sm.text(toks[1].location) == U"1F");
+	assert(sm.text(toks[2].location) == U"name");
+	assert(sm.text(toks[3].location) == U"\uFFFD");
+	assert(sm.text(toks[4].location) == U"\u00EF");
+	assert(sizeof(Token) <= 24);
+}
+
+// The class tables agree with the plain definitions, and identifiers take
+// in Unicode letters and marks but not symbols
+static void check_identifiers()
+{
+	for (char32_t ch = 0; ch < 0x400; ch++)
+	{
+		bool upper = (ch >= 'A' && ch <= 'Z');
+		bool lower = (ch >= 'a' && ch <= 'z');
+		bool digit = (ch >= '0' && ch <= '9');
+		assert(is_alpha(ch) == (upper || lower));
+		assert(is_digit(ch) == digit);
+		assert(is_hex(ch) == (digit || (ch >= 'a' && ch <= 'f') ||
+		                      (ch >= 'A' && ch <= 'F')));
+		assert(is_octal(ch) == (ch >= '0' && ch <= '7'));
+		assert(is_binary(ch) == (ch == '0' || ch == '1'));
+		if (ch < 0x80)
+			assert(is_ident_continue(ch) == (upper || lower || digit ||
+			                                 ch == '_'));
+		(void)upper;
+		(void)lower;
+		(void)digit;
+	}
+	assert(is_whitespace(0xA0) && is_whitespace(0x3000));
+	assert(!is_whitespace(0x200B) && !is_whitespace('x'));
+	assert(is_newline(0x85) && is_newline(0x2029) && !is_newline(' '));
+	assert(is_xid_start(U'\u00E9') && is_xid_start(U'\u8B8A'));
+	assert(!is_xid_start(U'\u0661') && is_xid_continue(U'\u0661'));
+	assert(!is_xid_continue(U'\u20AC') && !is_xid_continue(0x1F600));
+	assert(is_xid_continue(0xE0100) && !is_xid_continue(0x10FFFF));
+
+	static const char src[] =
+		"gr\xC3\xB6\xC3\x9F" "e \xE8\xAE\x8A\xE6\x95\xB8 x\xD9\xA1 _1 "
+		"\xE2\x82\xAC";
+	SourceManager sm;
+	TokenList toks = tokenize(sm.add_buffer("u.soda", src, sizeof(src) - 1));
+	assert(toks.size() == 5);
+	assert(sm.text(toks[0].location) == U"gr\u00F6\u00DFe");
+	assert(sm.text(toks[1].location) == U"\u8B8A\u6578");
+	assert(sm.text(toks[2].location) == U"x\u0661");
+	assert(toks[3].kind == Token::IDENT);
+	assert(toks[4].kind == Token::ERROR);
+}
+
+// Identifiers are interned as they're lexed, equal names share a Symbol
+static void check_interner()
+{
+	static const char src[] = "foo bar foo if foobar bar";
+	SourceManager sm;
+	Interner names;
+	TokenList toks = tokenize(sm.add_buffer("i.soda", src, sizeof(src) - 1),
+	                          &names);
+	assert(toks.size() == 6);
+	assert(toks[0].symbol == toks[2].symbol);
+	assert(toks[1].symbol == toks[5].symbol);
+	assert(toks[0].symbol != toks[1].symbol);
+	assert(toks[3].kind == Token::IF && toks[3].symbol == NO_SYMBOL);
+	assert(names.size() == 3);
+	assert(names.text(toks[4].symbol) == U"foobar");
+	assert(names.intern(U"bar") == toks[1].symbol);
+
+	// enough names to make the table grow a few times
+	std::vector<Symbol> syms;
+	for (int i = 0; i < 5000; i++)
+	{
+		std::string n = "n" + std::to_string(i);
+		syms.push_back(names.intern(std::u32string(n.begin(), n.end())));
+	}
+	for (int i = 0; i < 5000; i += 7)
+	{
+		std::string n = "n" + std::to_string(i);
+		assert(names.intern(std::u32string(n.begin(), n.end())) == syms[i]);
+	}
+	assert(names.size() == 5003);
+	assert(names.text(toks[0].symbol) == U"foo");
+}
+
+// The stream only buffers what lookahead and marks need, however long
+// the input
+static void check_token_stream()
+{
+	std::string src;
+	for (int i = 0; i < 10000; i++)
+		src += "n" + std::to_string(i) + " ";
+	Lexer lex(src.data(), src.data() + src.size());
+	TokenStream toks(lex);
+
+	size_t most = 0;
+	while (toks.position() < 5000)
+	{
+		assert(toks.current().location.start() == toks.peek(0).location.start());
+		assert(toks.peek(3).location.start() > toks.peek(2).location.start());
+		toks.next();
+		most = std::max(most, toks.buffered());
+	}
+	assert(most <= 16);
+
+	// backing up keeps everything since the mark
+	size_t start = toks.current().location.start();
+	size_t mark = toks.mark();
+	for (int i = 0; i < 100; i++)
+		toks.next();
+	assert(toks.buffered() >= 100);
+	toks.reset(mark);
+	assert(toks.position() == 5000);
+	assert(toks.current().location.start() == start);
+	toks.release(mark);
+
+	while (toks.current().kind != Token::END)
+		toks.next();
+	assert(toks.position() == 10000);
+	toks.next();
+	assert(toks.position() == 10000);
+	assert(toks.peek(5).kind == Token::END);
+	(void)most; (void)start;
+
+	// from a stream, the text of every token held can still be read while
+	// what's behind them is let go of
+	for (int i = 10000; i < 100000; i++)
+		src += "n" + std::to_string(i) + " ";
+	std::istringstream in(src);
+	SourceManager sm;
+	SourceFile& file = sm.add_stream("<stream>");
+	Lexer streamed(in, &file.lines, file.base);
+	TokenStream stoks(streamed);
+	for (int i = 0; i < 50000; i++)
+		stoks.next();
+	mark = stoks.mark();
+	for (int i = 0; i < 30000; i++)
+		stoks.next();
+	stoks.reset(mark);
+	assert(streamed.text(stoks.current()) == U"n50000");
+	stoks.release(mark);
+	for (int i = 50000; stoks.current().kind != Token::END; i++)
+	{
+		assert(utf8_encode(streamed.text(stoks.current())) ==
+		       "n" + std::to_string(i));
+		stoks.next();
+	}
+	assert(streamed.held() <= 4 * Input::WINDOW_SIZE);
+	streamed.finish(file);
+	assert(file.size == src.size() && !file.buffer);
+
+	// nor are the comments and whitespace between tokens kept, however
+	// much of it there is
+	std::string line = "//" + std::string(200, 'x') + "\n";
+	std::string comments = "first ";
+	while (comments.size() < 40 * Input::WINDOW_SIZE)
+		comments += line;
+	comments += "/*" + std::string(10 * Input::WINDOW_SIZE, '*') + "*/ " +
+	            std::string(10 * Input::WINDOW_SIZE, ' ') + "// " +
+	            std::string(10 * Input::WINDOW_SIZE, 'y') + "\nlast";
+	std::istringstream cin(comments);
+	Lexer clex(cin);
+	TokenStream ctoks(clex);
+	assert(clex.text(ctoks.current()) == U"first");
+	assert(ctoks.peek(1).kind == Token::IDENT);
+	assert(clex.held() <= 2 * Input::WINDOW_SIZE);
+	assert(clex.text(ctoks.current()) == U"first");
+	assert(clex.text(ctoks.peek(1)) == U"last");
+}
+
+// A plain longest-match lexer for operators, comments, spaces and the
+// identifier "a", to check the DFA against
+struct RefToken
+{
+	Token::Kind kind;
+	size_t start, len;
+};
+
+static std::vector<RefToken> ref_lex(const std::string& s)
+{
+	static const struct { const char *text; Token::Kind kind; } ops[] = {
+		{ ">>=", Token::RSHIFT_ASSIGN }, { "<<=", Token::LSHIFT_ASSIGN },
+		{ ">>", Token::RSHIFT }, { "<<", Token::LSHIFT },
+		{ "+=", Token::ADD_ASSIGN }, { "++", Token::INC_OP },
+		{ "-=", Token::SUB_ASSIGN }, { "--", Token::DEC_OP },
+		{ "->", Token::PTR_OP }, { "*=", Token::MUL_ASSIGN },
+		{ "/=", Token::DIV_ASSIGN }, { "%=", Token::MOD_ASSIGN },
+		{ "&=", Token::AND_ASSIGN }, { "^=", Token::XOR_ASSIGN },
+		{ "|=", Token::OR_ASSIGN }, { "&&", Token::LOG_AND },
+		{ "||", Token::LOG_OR }, { "<=", Token::LE_OP },
+		{ ">=", Token::GE_OP }, { "!=", Token::NE_OP },
+		{ "==", Token::EQ_OP },
+	};
+	std::vector<RefToken> toks;
+	size_t i = 0;
+	while (i < s.size())
+	{
+		if (s[i] == ' ')
+			i++;
+		else if (s[i] == 'a')
+		{
+			size_t len = s.find_first_not_of('a', i);
+			len = (len == std::string::npos ? s.size() : len) - i;
+			toks.push_back({ Token::IDENT, i, len });
+			i += len;
+		}
+		else if (s.compare(i, 2, "//") == 0)
+			i = s.size();
+		else if (s.compare(i, 2, "/*") == 0)
+		{
+			size_t close = s.find("*/", i + 2);
+			i = (close == std::string::npos) ? s.size() : close + 2;
+		}
+		else
+		{
+			RefToken tok = { Token::Kind(s[i]), i, 1 };
+			for (auto& op : ops)
+			{
+				if (s.compare(i, strlen(op.text), op.text) == 0)
+				{
+					tok = { op.kind, i, strlen(op.text) };
+					break;
+				}
+			}
+			toks.push_back(tok);
+			i += tok.len;
+		}
+	}
+	return toks;
+}
+
+// Every string of up to four operator characters lexes the same as the
+// reference
+static void check_operators()
+{
+	const std::string chars = "<>=+-*/%&^|!.~?:;,()[]{} a";
+	std::vector<std::string> strs(1, std::string());
+	for (int len = 1; len <= 4; len++)
+	{
+		std::vector<std::string> longer;
+		for (const std::string& prefix : strs)
+			for (char ch : chars)
+				longer.push_back(prefix + ch);
+		for (const std::string& s : longer)
+		{
+			std::vector<RefToken> ref = ref_lex(s);
+			Lexer lex(s.data(), s.data() + s.size());
+			for (const RefToken& r : ref)
+			{
+				lex.next();
+				assert(lex.token.kind == r.kind);
+				assert(lex.token.location.start() == r.start);
+				assert(lex.token.location.length == r.len);
+				(void)r;
+			}
+			assert(lex.next() == Token::END);
+		}
+		strs.swap(longer);
+	}
+}
+
+// The same tokens, values included: a number's value, otherwise the symbol
+static bool same_tokens(const TokenList& a, const TokenList& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		Token x = a[i], y = b[i];
+		if (x.kind != y.kind ||
+		    x.location.start() != y.location.start() ||
+		    x.location.length != y.location.length)
+			return false;
+		if (is_number(x.kind) ? (x.integer != y.integer || x.status != y.status)
+		                      : x.symbol != y.symbol)
+			return false;
+	}
+	return true;
+}
+
+// Split into tiny pieces, random text full of strings, character literals
+// and comments that cross line breaks still lexes the same as tokenize()
+static void check_parallel()
+{
+	const std::string chars = "ab01 .x\"'/*\\\n\n\n";
+	uint32_t seed = 1;
+	for (int round = 0; round < 500; round++)
+	{
+		std::string src;
+		size_t len = 1 + round * 4;
+		for (size_t i = 0; i < len; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			src += chars[(seed >> 16) % chars.size()];
+		}
+		LineTable lines, par_lines;
+		TokenList tokens = tokenize(src.data(), src.data() + src.size(), &lines);
+		TokenList par = tokenize_parallel(src.data(), src.data() + src.size(),
+		                                  &par_lines, 1 + round % 8, 8);
+		assert(same_tokens(par, tokens));
+		assert(par_lines.lines() == lines.lines());
+	}
+}
+
+// Random edits to random text keep relexed tokens the same as lexing it
+// all again, and an edit in the middle of a long file relexes a token
+static void check_relex()
+{
+	const std::string chars = "ab01 .x\"'/*\\\n+=";
+	uint32_t seed = 7;
+	auto rand = [&seed](size_t n) -> size_t
+	{
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 16) % n;
+	};
+	std::string src;
+	TokenList tokens;
+	for (int round = 0; round < 3000; round++)
+	{
+		if (round % 100 == 0)
+		{
+			src.clear();
+			tokens.clear();
+		}
+		size_t offset = rand(src.size() + 1);
+		size_t removed = rand(std::min<size_t>(src.size() - offset, 4) + 1);
+		std::string text;
+		for (size_t n = rand(6); n > 0; n--)
+			text += chars[rand(chars.size())];
+		src.replace(offset, removed, text);
+		relex(tokens, src.data(), src.data() + src.size(),
+		      TextEdit(offset, removed, text.size()));
+		assert(same_tokens(tokens,
+		                   tokenize(src.data(), src.data() + src.size())));
+	}
+
+	src.clear();
+	for (int i = 0; i < 10000; i++)
+		src += "name + 1;\n";
+	tokens = tokenize(src.data(), src.data() + src.size());
+	src.replace(50000, 4, "other");
+	TokenEdit edit = relex(tokens, src.data(), src.data() + src.size(),
+	                       TextEdit(50000, 4, 5));
+	assert(edit.removed <= 5 && edit.inserted <= 5);
+	assert(same_tokens(tokens, tokenize(src.data(), src.data() + src.size())));
+	(void)edit;
+}
+
+// Comments are skipped without recursing however many there are in a row,
+// and recorded as trivia when asked
+static void check_trivia()
+{
+	std::string src;
+	for (int i = 0; i < 200000; i++)
+		src += "// generated\n/**/";
+	src += "name";
+	TokenList tokens = tokenize(src.data(), src.data() + src.size());
+	assert(tokens.size() == 1 && tokens[0].kind == Token::IDENT);
+
+	src = "a // one\n/* two\n */ b /* open";
+	TriviaList trivia;
+	tokens = tokenize(src.data(), src.data() + src.size(), nullptr, &trivia);
+	assert(tokens.size() == 2);
+	assert(trivia.size() == 3);
+	assert(trivia[0].kind == Trivia::LINE_COMMENT);
+	assert(trivia[0].location.start() == 2 && trivia[0].location.end() == 8);
+	assert(trivia[1].kind == Trivia::BLOCK_COMMENT);
+	assert(trivia[1].location.start() == 9 && trivia[1].location.end() == 19);
+	assert(trivia[2].kind == Trivia::BLOCK_COMMENT);
+	assert(trivia[2].location.start() == 22 &&
+	       trivia[2].location.end() == src.size());
+
+	// malformed UTF-8 is diagnosed in either kind of comment, and a line
+	// comment still ends at a Unicode line break
+	src = "// bad \xFF byte, caf\xC3\xA9\xE2\x80\xA8x /* \xC3 */";
+	Lexer lex(src.data(), src.data() + src.size());
+	assert(lex.next() == Token::IDENT);
+	assert(lex.next() == Token::END);
+	assert(lex.diagnostics().size() == 2);
+	assert(lex.diagnostics()[0].offset == 7);
+}
+
+// Long literals and comments, skipped in bulk, come out the same from a
+// buffer and from a stream read a window at a time
+static void check_long_literals()
+{
+	std::string body;
+	for (int i = 0; i < 20000; i++)
+		body += "text \\\" * caf\xC3\xA9 \xFF ";
+	std::string src = "\"" + body + "\" '" + body + "' /*" + body + "*/ x";
+	TokenList tokens = tokenize(src.data(), src.data() + src.size());
+	assert(tokens.size() == 3);
+	assert(tokens[0].kind == Token::STR_LIT);
+	assert(tokens[0].location.start() == 1);
+	assert(tokens[0].location.length == body.size());
+	assert(tokens[1].kind == Token::CHAR_ICONST);
+	assert(tokens[1].location.length == body.size());
+	assert(tokens[2].kind == Token::IDENT);
+
+	src = "\"" + body;
+	tokens = tokenize(src.data(), src.data() + src.size());
+	assert(tokens.size() == 1 && tokens[0].kind == Token::ERROR);
+	assert(tokens[0].location.end() == src.size());
+
+	src = "/*" + body + "**/ '" + body + "\\'' \"a\\\"\" x";
+	Lexer buffered(src.data(), src.data() + src.size());
+	std::istringstream in(src);
+	Lexer streamed(in);
+	const Token& a = buffered.token;
+	const Token& b = streamed.token;
+	size_t n = 0;
+	Token::Kind k;
+	while ((k = buffered.next()) != Token::END)
+	{
+		assert(streamed.next() == k);
+		assert(a.location.offset == b.location.offset);
+		assert(a.location.length == b.location.length);
+		n++;
+	}
+	assert(streamed.next() == Token::END);
+	assert(n == 3);
+	assert(buffered.diagnostics().size() == 40000);
+	assert(streamed.diagnostics().size() == 40000);
+	(void)a;
+	(void)b;
+	(void)n;
+	(void)k;
+}
+
+// The value of the single literal token in src
+static bool lex_literal(const std::string& src, std::u32string& value)
+{
+	Lexer lex(src.data(), src.data() + src.size());
+	Token::Kind k = lex.next();
+	assert(k == Token::STR_LIT || k == Token::CHAR_ICONST);
+	(void)k;
+	value.clear();
+	return lex.literal(lex.token, value);
+}
+
+static void check_escapes()
+{
+	std::u32string value;
+	assert(lex_literal("\"plain caf\xC3\xA9\"", value));
+	assert(value == U"plain caf\u00e9");
+	assert(lex_literal("\"a\\tb\\n\\\\\\\"\\'\\0\"", value));
+	assert(value == std::u32string(U"a\tb\n\\\"'") + char32_t(0));
+	assert(lex_literal("'\\x41\\u00e9\\U0001F600'", value));
+	assert(value == U"A\u00e9\U0001F600");
+
+	// a backslash before the closing quote doesn't end the literal
+	std::string src = "\"\\\\\" x";
+	TokenList tokens = tokenize(src.data(), src.data() + src.size());
+	assert(tokens.size() == 2 && tokens[1].kind == Token::IDENT);
+
+	assert(!lex_literal("\"\\q\"", value));
+	assert(!lex_literal("\"\\x4\"", value));
+	assert(!lex_literal("\"\\uD800\"", value));
+	assert(!lex_literal("\"\\U00110000\"", value));
+}
+
+// The value goes with the token, so it's still there once the lexer's gone
+static NumberValue lex_number(const std::string& src, Token::Kind kind)
+{
+	TokenList tokens = tokenize(src.data(), src.data() + src.size());
+	assert(tokens.size() == 1 && tokens.kind(0) == kind);
+	(void)kind;
+	return tokens[0].number();
+}
+
+#define CHECK_INT(src, kind, val)                                   \
+	do {                                                            \
+		NumberValue num = lex_number(src, Token::kind);             \
+		assert(num.status == NumberValue::VALID);                   \
+		assert(num.integer == (val));                               \
+		(void)num;                                                  \
+	} while (0)
+
+#define CHECK_BAD(src, kind, status_)                               \
+	assert(lex_number(src, Token::kind).status == NumberValue::status_)
+
+// Integers in every base up to the edge of 64 bits, and floats rounded the
+// same as strtod()
+static void check_numbers()
+{
+	CHECK_INT("0", DEC_ICONST, 0u);
+	CHECK_INT("0042", DEC_ICONST, 42u);
+	CHECK_INT("18446744073709551615", DEC_ICONST, 18446744073709551615u);
+	CHECK_BAD("18446744073709551616", DEC_ICONST, OUT_OF_RANGE);
+	CHECK_BAD("99999999999999999999", DEC_ICONST, OUT_OF_RANGE);
+	CHECK_INT("0x1fAB", HEX_ICONST, 0x1FABu);
+	CHECK_INT("0xFFFFFFFFFFFFFFFF", HEX_ICONST, 0xFFFFFFFFFFFFFFFFu);
+	CHECK_BAD("0x10000000000000000", HEX_ICONST, OUT_OF_RANGE);
+	CHECK_INT("0b101", BIN_ICONST, 5u);
+	CHECK_BAD(std::string("0b1") + std::string(64, '0'), BIN_ICONST,
+	          OUT_OF_RANGE);
+	CHECK_INT("0o17", OCT_ICONST, 15u);
+	CHECK_INT("0o1777777777777777777777", OCT_ICONST, 0xFFFFFFFFFFFFFFFFu);
+	CHECK_BAD("0o2000000000000000000000", OCT_ICONST, OUT_OF_RANGE);
+	CHECK_BAD("0x", HEX_ICONST, MALFORMED);
+	CHECK_BAD("1.2.3", FCONST, MALFORMED);
+	CHECK_BAD(std::string(400, '9') + ".0", FCONST, OUT_OF_RANGE);
+
+	uint32_t seed = 3;
+	auto digits = [&seed](size_t n)
+	{
+		std::string s;
+		for (size_t i = 0; i < n; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			s += char('0' + (seed >> 16) % 10);
+		}
+		return s;
+	};
+	std::vector<std::string> floats = {
+		"0.1", "1.", ".5", "9007199254740993.0", "0.30000000000000004",
+		"179769313486231580793728971405301.0" + std::string(280, '0'),
+		"0." + std::string(330, '0') + "4940656458412465441765687928682213",
+	};
+	for (size_t i = 0; i < 20000; i++)
+		floats.push_back(digits(i % 23) + "." + digits(1 + i % 29));
+	for (const std::string& src : floats)
+	{
+		NumberValue num = lex_number(src, Token::FCONST);
+		double want = std::strtod(src.c_str(), nullptr);
+		assert(std::memcmp(&num.real, &want, sizeof(want)) == 0);
+		(void)num;
+		(void)want;
+	}
+}
+
+// Spans as text, a letter for the class then the text in brackets
+static std::string show_spans(const std::string& src,
+                              const std::vector<HighlightSpan>& spans)
+{
+	std::string out;
+	for (const HighlightSpan& span : spans)
+	{
+		out += "KINSCOE"[span.kind];
+		out += "[" + src.substr(span.offset, span.length) + "] ";
+	}
+	return out;
+}
+
+static void check_highlight()
+{
+	std::string src = "// note\nclass A { var s = \"a\\\"b\"; int n = 0x1F"
+	                  " + 'c'; } /* end */";
+	std::vector<HighlightSpan> spans(64);
+	spans.resize(highlight(src.data(), src.data() + src.size(), 0,
+	                       src.size(), spans.data(), spans.size()));
+	assert(show_spans(src, spans) ==
+	       "C[// note] K[class] I[A] O[{] K[var] I[s] O[=] S[\"a\\\"b\"] "
+	       "O[;] I[int] I[n] O[=] N[0x1F] O[+] S['c'] O[;] O[}] "
+	       "C[/* end */] ");
+
+	// stopping short, at the end of the viewport or when spans is full
+	size_t n = highlight(src.data(), src.data() + src.size(), 0,
+	                     src.find("var"), spans.data(), spans.size());
+	assert(n == 4);
+	n = highlight(src.data(), src.data() + src.size(), 0, src.size(),
+	              spans.data(), 2);
+	assert(n == 2 && spans[1].offset == src.find("class"));
+
+	// a viewport anywhere, started from the token list, matches the spans
+	// of the whole buffer
+	src.clear();
+	for (int i = 0; i < 500; i++)
+		src += "/* block\n comment */ name = \"a long\n string\" + 0b101;\n";
+	TokenList tokens = tokenize(src.data(), src.data() + src.size());
+	std::vector<HighlightSpan> all(src.size());
+	all.resize(highlight(src.data(), src.data() + src.size(), 0, src.size(),
+	                     all.data(), all.size()));
+	for (size_t offset = 0; offset < src.size(); offset += 7)
+	{
+		size_t from = highlight_start(tokens, offset);
+		assert(from <= offset);
+		spans.resize(8);
+		n = highlight(src.data(), src.data() + src.size(), from, offset + 20,
+		              spans.data(), spans.size());
+		// from is never inside a span
+		size_t i = 0;
+		while (i < all.size() && all[i].offset < from)
+			i++;
+		assert(i == 0 || all[i - 1].offset + all[i - 1].length <= from);
+		assert(i + n <= all.size());
+		for (size_t j = 0; j < n; j++)
+		{
+			assert(spans[j].offset == all[i + j].offset);
+			assert(spans[j].length == all[i + j].length);
+			assert(spans[j].kind == all[i + j].kind);
+		}
+	}
+	(void)n;
+}
+
+// Every kind survives being packed into a byte, and a TokenList gives
+// back what was put in
+static void check_token_list()
+{
+	for (int k = -1; k < KindCodes::LIMIT; k++)
+	{
+		Token::Kind kind = Token::Kind(k);
+		if (std::to_string(kind).compare(0, 7, "Unknown") != 0)
+			assert(expand_kind(compact_kind(kind)) == kind);
+	}
+	assert(expand_kind(compact_kind(Token::END)) == Token::END);
+
+	const char src[] = "fun f(x) { return \"s\" + 0x1F; } /* c */ y";
+	Interner interner;
+	SourceManager sm;
+	SourceFile& file = sm.add_buffer("list", src, sizeof(src) - 1);
+	Lexer lex(src, src + sizeof(src) - 1, nullptr, file.base, &interner);
+	std::vector<Token> plain;
+	TokenList list;
+	while (lex.next() != Token::END)
+	{
+		plain.push_back(lex.token);
+		list.push_back(lex.token);
+	}
+	assert(list.size() == plain.size());
+	for (size_t i = 0; i < plain.size(); i++)
+	{
+		assert(list[i].kind == plain[i].kind);
+		assert(list.kind(i) == plain[i].kind);
+		assert(list[i].location.start() == plain[i].location.start());
+		assert(list[i].location.length == plain[i].location.length);
+		if (is_number(plain[i].kind))
+			assert(list[i].number().integer == plain[i].number().integer);
+		else
+			assert(list[i].symbol == plain[i].symbol);
+	}
+	assert(list.find(plain[3].location.start()) == 3);
+
+	TokenList tail;
+	tail.append(list, 4);
+	// a number keeps its value through replace after replace
+	for (int round = 0; round < 100; round++)
+		list.replace(9, 1, tail, 5, 6);
+	assert(list.kind(9) == Token::HEX_ICONST);
+	assert(list[9].number().integer == 0x1F);
+	list.replace(1, 2, tail, 0, 3);
+	assert(list.size() == plain.size() + 1);
+	assert(list.kind(1) == plain[4].kind && list.kind(4) == plain[3].kind);
+	list.shift(4, uint32_t(-2));
+	assert(list.start(4) == plain[3].location.start() - 2);
+}
+
 int main()
 {
+	check_sources();
+	check_text();
+	check_identifiers();
+	check_interner();
+	check_operators();
+	check_token_stream();
+	check_parallel();
+	check_relex();
+	check_trivia();
+	check_long_literals();
+	check_escapes();
+	check_numbers();
+	check_token_list();
+	check_highlight();
+
 	std::stringstream ss;
 	Token::Kind k;
 	(void)k; // prevent warning in ndebug mode
@@ -30,6 +756,46 @@ int main()
 	CHECK("int", IDENT, U"int");
 	CHECK("double", IDENT, U"double");
 
+	CHECK("if", IF, U"if");
+	CHECK("elif", ELIF, U"elif");
+	CHECK("else", ELSE, U"else");
+	CHECK("fun", FUN, U"fun");
+	CHECK("var", VAR, U"var");
+	CHECK("struct", STRUCT, U"struct");
+	CHECK("enum", ENUM, U"enum");
+	CHECK("union", UNION, U"union");
+	CHECK("alias", ALIAS, U"alias");
+	CHECK("return", RETURN, U"return");
+	CHECK("import", IMPORT, U"import");
+	CHECK("from", FROM, U"from");
+	CHECK("class", CLASS, U"class");
+	CHECK("switch", SWITCH, U"switch");
+	CHECK("case", CASE, U"case");
+	CHECK("default", DEFAULT, U"default");
+	CHECK("break", BREAK, U"break");
+	CHECK("const", CONST, U"const");
+	CHECK("static", STATIC, U"static");
+	CHECK("public", PUBLIC, U"public");
+	CHECK("private", PRIVATE, U"private");
+	CHECK("protected", PROTECTED, U"protected");
+	CHECK("internal", INTERNAL, U"internal");
+	CHECK("namespace", NAMESPACE, U"namespace");
+	CHECK("delegate", DELEGATE, U"delegate");
+	CHECK("CCode", CCODE, U"CCode");
+
+	// close to keywords but not
+	CHECK("i", IDENT, U"i");
+	CHECK("iff", IDENT, U"iff");
+	CHECK("_if", IDENT, U"_if");
+	CHECK("elif2", IDENT, U"elif2");
+	CHECK("Class", IDENT, U"Class");
+	CHECK("ccode", IDENT, U"ccode");
+	CHECK("CCod", IDENT, U"CCod");
+	CHECK("returns", IDENT, U"returns");
+	CHECK("namespaces", IDENT, U"namespaces");
+	CHECK("delegat", IDENT, U"delegat");
+	CHECK("void", IDENT, U"void");
+
 	CHECK("0x00ff", HEX_ICONST, U"00ff");
 	CHECK("0b1001", BIN_ICONST, U"1001");
 	CHECK("0o755", OCT_ICONST, U"755");
@@ -41,6 +807,7 @@ int main()
 	CHECK("'\\''", CHAR_ICONST, U"\\'");
 	CHECK("\"FOO\"", STR_LIT, U"FOO");
 	CHECK("\"\\\"\"", STR_LIT, U"\\\"");
+	CHECK("\"\"", STR_LIT, U"");
 
 	//CHECK("// some comment\n", COMMENT, U"// some comment");
 	//CHECK("/* a multi\n comment */", COMMENT, U" a multi\n comment ");
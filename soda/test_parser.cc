@@ -2,10 +2,33 @@
 #include <soda/parser.h>
 #include <soda/debugvisitor.h>
 #include <cassert>
+#include <cstdlib>
 #include <fstream>
+#include <new>
 
 using namespace Soda;
 
+// Every allocation made, to see what a parse costs
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+	allocations++;
+	if (void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	std::free(p);
+}
+
 int main()
 {
 	TU tu("test.soda");
@@ -16,6 +39,71 @@ int main()
 		assert(tu.stmts.size() > 0);
 		DebugVisitor printer(std::cout);
 		tu.accept(printer);
+
+		// equal string literals, however they're written, are pooled once
+		TU strings("strings.soda");
+		parse(strings, "string a = \"ab\" \"c\"; string b = \"a\\x62c\";");
+		assert(strings.literals.size() == 1);
+		assert(strings.literals.text(0) == U"abc");
+
+		// a context parses one input after another, each as parse() would.
+		// Only its lexer and token buffers are reused, so once they've
+		// grown to fit, each parse allocates the same: its AST and what
+		// goes in the TU, less than parse() on its own.
+		const std::string src = "namespace n { int x = 1 + 2; }";
+		ParseContext context;
+		size_t counts[3];
+		for (int i = 0; i < 3; i++)
+		{
+			TU snippet("snippet.soda");
+			size_t before = allocations;
+			context.parse(snippet, src);
+			counts[i] = allocations - before;
+			assert(snippet.stmts.size() == 1);
+			assert(snippet.interner.size() == 3);
+		}
+		TU alone("snippet.soda");
+		size_t before = allocations;
+		parse(alone, src);
+		assert(counts[1] == counts[2]);
+		assert(counts[2] < allocations - before);
+		(void)counts;
+		(void)before;
+		TU bad("bad.soda");
+		bool threw = false;
+		try
+		{
+			context.parse(bad, "int x = ;");
+		}
+		catch (SyntaxError&)
+		{
+			threw = true;
+		}
+		assert(threw);
+		(void)threw;
+
+		// error columns count code points, so a multibyte identifier
+		// before the error counts once
+		int columns[2] = { -1, -1 };
+		const char *lines[2] = { "int cafe = 1; int x = ;",
+		                         "int caf\xC3\xA9 = 1; int x = ;" };
+		for (int i = 0; i < 2; i++)
+		{
+			TU wide("wide.soda");
+			try
+			{
+				context.parse(wide, lines[i]);
+			}
+			catch (SyntaxError& err)
+			{
+				columns[i] = err.column();
+			}
+		}
+		assert(columns[0] > 14 && columns[1] == columns[0]);
+		(void)columns;
+		TU good("good.soda");
+		context.parse(good, "string s = \"ok\";");
+		assert(good.stmts.size() == 1 && good.literals.size() == 1);
 	}
 	catch (SyntaxError& err)
 	{
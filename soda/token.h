@@ -1,6 +1,7 @@
 #ifndef SODA_TOKEN_H
 #define SODA_TOKEN_H
 
+#include <soda/interner.h>
 #include <soda/sourcelocation.h>
 #include <limits>
 #include <string>
@@ -9,6 +10,25 @@
 namespace Soda
 {
 
+// The value of a numeric literal, worked out by the lexer as it scans the
+// digits
+struct NumberValue
+{
+	enum Status : uint8_t
+	{
+		VALID,
+		OUT_OF_RANGE, // more than 64 bits, or past the largest double
+		MALFORMED,    // no digits after a prefix, or a second '.'
+	};
+
+	union
+	{
+		uint64_t integer; // HEX/BIN/OCT/DEC_ICONST
+		double real;      // FCONST
+	};
+	Status status;
+};
+
 struct Token
 {
 	enum Kind {
@@ -106,44 +126,76 @@ struct Token
 	};
 
 	Kind kind;
+	// The extent of the token's text, which leaves out the quotes around
+	// string and character literals and the 0x/0b/0o of integers. Tokens
+	// don't copy their text, SourceManager::text() or Lexer::text() decode
+	// it from the source when it's needed.
 	SourceLocation location;
-	std::u32string text;
+	// The value of a number is carried by the token, so it's still good
+	// once the lexer has gone (see number())
+	NumberValue::Status status;
+	union
+	{
+		// The interned name of an IDENT, if the lexer was given an Interner
+		Symbol symbol;
+		uint64_t integer;
+		double real;
+	};
 
-	Token() : kind(ZERO), location(0,0,0,0,0,0), text() {}
+	Token()
+		: kind(ZERO), location(0,0), status(NumberValue::VALID),
+		  symbol(NO_SYMBOL) {}
 
-	void clear()
+	NumberValue number() const
 	{
-		text.clear();
-		kind = ZERO;
+		NumberValue num;
+		num.integer = integer;
+		num.status = status;
+		return num;
 	}
 
-	Token(const Token& tok)
-		: kind(tok.kind), location(tok.location), text(tok.text) {}
+	void set_number(const NumberValue& num)
+	{
+		integer = num.integer;
+		status = num.status;
+	}
 
-	Token& operator=(const Token& rhs)
+	void clear()
 	{
-		if (&rhs != this)
-		{
-			kind = rhs.kind;
-			location = rhs.location;
-			text = rhs.text;
-		}
-		return *this;
+		kind = ZERO;
+		symbol = NO_SYMBOL;
 	}
 
 	void swap(Token& rhs)
 	{
-		Kind k = rhs.kind;
-		rhs.kind = kind;
-		kind = k;
-		SourceLocation loc = rhs.location;
-		rhs.location = location;
-		location = loc;
-		text.swap(rhs.text);
+		Token tmp = rhs;
+		rhs = *this;
+		*this = tmp;
 	}
 };
 
-typedef std::vector<Token> TokenList;
+inline bool is_number(Token::Kind kind)
+{
+	return kind == Token::HEX_ICONST || kind == Token::BIN_ICONST ||
+	       kind == Token::OCT_ICONST || kind == Token::DEC_ICONST ||
+	       kind == Token::FCONST;
+}
+
+// A comment the lexer skipped, which it only keeps when asked to (for
+// formatters and documentation tools)
+struct Trivia
+{
+	enum Kind : uint8_t
+	{
+		LINE_COMMENT,  // up to but not including the line break
+		BLOCK_COMMENT, // including the */, unless it runs to the end
+	};
+
+	SourceLocation location;
+	Kind kind;
+};
+
+typedef std::vector<Trivia> TriviaList;
 
 } // namespace Soda
 
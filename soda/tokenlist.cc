@@ -0,0 +1,210 @@
+#include <soda/sodainc.h> // pch
+#include <soda/tokenlist.h>
+#include <algorithm>
+#include <cassert>
+
+namespace Soda
+{
+
+// END and ERROR, the negative kinds, are 0 and 1, these follow them
+static const Token::Kind dense_kinds[] = {
+	Token::ZERO,
+	Token::LT,
+	Token::GT,
+	Token::EQ,
+	Token::PLUS,
+	Token::MINUS,
+	Token::MULTIPLY,
+	Token::DIVIDE,
+	Token::MODULO,
+	Token::BOOL_AND,
+	Token::BOOL_XOR,
+	Token::BOOL_OR,
+	Token::NOT,
+	Token::DOT,
+	Token::TILDE,
+	Token::QUESTION,
+	Token::COLON,
+	Token::SEMICOLON,
+	Token::COMMA,
+	Token::LPAREN,
+	Token::RPAREN,
+	Token::LBRACKET,
+	Token::RBRACKET,
+	Token::LBRACE,
+	Token::RBRACE,
+	Token::IDENT,
+	Token::HEX_ICONST,
+	Token::BIN_ICONST,
+	Token::OCT_ICONST,
+	Token::DEC_ICONST,
+	Token::CHAR_ICONST,
+	Token::FCONST,
+	Token::STR_LIT,
+	Token::COMMENT,
+	Token::RSHIFT,
+	Token::RSHIFT_ASSIGN,
+	Token::LSHIFT,
+	Token::LSHIFT_ASSIGN,
+	Token::ADD_ASSIGN,
+	Token::INC_OP,
+	Token::SUB_ASSIGN,
+	Token::DEC_OP,
+	Token::MUL_ASSIGN,
+	Token::DIV_ASSIGN,
+	Token::MOD_ASSIGN,
+	Token::AND_ASSIGN,
+	Token::XOR_ASSIGN,
+	Token::OR_ASSIGN,
+	Token::LOG_AND,
+	Token::LOG_OR,
+	Token::PTR_OP,
+	Token::LE_OP,
+	Token::GE_OP,
+	Token::NE_OP,
+	Token::EQ_OP,
+	Token::CONST,
+	Token::STATIC,
+	Token::PUBLIC,
+	Token::PRIVATE,
+	Token::PROTECTED,
+	Token::INTERNAL,
+	Token::STRUCT,
+	Token::ENUM,
+	Token::UNION,
+	Token::ALIAS,
+	Token::VAR,
+	Token::FUN,
+	Token::RETURN,
+	Token::IMPORT,
+	Token::FROM,
+	Token::CLASS,
+	Token::IF,
+	Token::ELIF,
+	Token::ELSE,
+	Token::SWITCH,
+	Token::CASE,
+	Token::DEFAULT,
+	Token::BREAK,
+	Token::VOID,
+	Token::NAMESPACE,
+	Token::DELEGATE,
+	Token::CCODE,
+};
+
+KindCodes::KindCodes()
+{
+	std::fill(codes, codes + LIMIT, 0);
+	std::fill(kinds, kinds + 256, Token::ZERO);
+	kinds[0] = Token::END;
+	kinds[1] = Token::ERROR;
+	uint8_t code = 2;
+	for (Token::Kind kind : dense_kinds)
+	{
+		assert(kind >= 0 && kind < LIMIT);
+		codes[kind] = code;
+		kinds[code++] = kind;
+	}
+}
+
+const KindCodes kind_codes;
+
+void TokenList::clear()
+{
+	kinds.clear();
+	offsets.clear();
+	lengths.clear();
+	values.clear();
+	numbers.clear();
+	dead_numbers = 0;
+}
+
+void TokenList::reserve(size_t n)
+{
+	kinds.reserve(n);
+	offsets.reserve(n);
+	lengths.reserve(n);
+	values.reserve(n);
+}
+
+void TokenList::push_back(const Token& tok)
+{
+	kinds.push_back(compact_kind(tok.kind));
+	offsets.push_back(tok.location.offset);
+	lengths.push_back(tok.location.length);
+	if (is_number(tok.kind))
+	{
+		values.push_back(numbers.size());
+		numbers.push_back(tok.number());
+	}
+	else
+		values.push_back(tok.symbol);
+}
+
+size_t TokenList::find(size_t offset) const
+{
+	return std::lower_bound(offsets.begin(), offsets.end(), offset) -
+	       offsets.begin();
+}
+
+template< typename T >
+static void replace_range(std::vector<T>& to, size_t first, size_t count,
+                          const std::vector<T>& from, size_t begin, size_t end)
+{
+	size_t common = std::min(count, end - begin);
+	std::copy(from.begin() + begin, from.begin() + begin + common,
+	          to.begin() + first);
+	if (end - begin > count)
+		to.insert(to.begin() + first + common, from.begin() + begin + common,
+		          from.begin() + end);
+	else
+		to.erase(to.begin() + first + common, to.begin() + first + count);
+}
+
+void TokenList::replace(size_t first, size_t count, const TokenList& other,
+                        size_t from, size_t to)
+{
+	assert(&other != this);
+	for (size_t i = first; i < first + count; i++)
+		if (is_number(kind(i)))
+			dead_numbers++;
+	// other's numbers index its own table, copy them over to this one's
+	std::vector<uint32_t> moved(other.values.begin() + from,
+	                            other.values.begin() + to);
+	for (size_t i = from; i < to; i++)
+		if (is_number(other.kind(i)))
+		{
+			moved[i - from] = numbers.size();
+			numbers.push_back(other.numbers[other.values[i]]);
+		}
+
+	replace_range(kinds, first, count, other.kinds, from, to);
+	replace_range(offsets, first, count, other.offsets, from, to);
+	replace_range(lengths, first, count, other.lengths, from, to);
+	replace_range(values, first, count, moved, 0, moved.size());
+	// relexing edit after edit would otherwise grow the table for good
+	if (dead_numbers > numbers.size() / 2)
+		compact_numbers();
+}
+
+void TokenList::compact_numbers()
+{
+	std::vector<NumberValue> live;
+	live.reserve(numbers.size() - dead_numbers);
+	for (size_t i = 0; i < kinds.size(); i++)
+		if (is_number(kind(i)))
+		{
+			live.push_back(numbers[values[i]]);
+			values[i] = live.size() - 1;
+		}
+	numbers.swap(live);
+	dead_numbers = 0;
+}
+
+void TokenList::shift(size_t first, uint32_t delta)
+{
+	for (size_t i = first; i < offsets.size(); i++)
+		offsets[i] += delta;
+}
+
+} // namespace Soda
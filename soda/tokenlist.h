@@ -0,0 +1,94 @@
+#ifndef SODA_TOKENLIST_H
+#define SODA_TOKENLIST_H
+
+#include <soda/token.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Soda
+{
+
+// Token kinds renumbered densely from 0, so one fits in a byte
+struct KindCodes
+{
+	static const int LIMIT = 768; // past the largest non-negative kind
+	uint8_t codes[LIMIT];
+	Token::Kind kinds[256];
+	KindCodes();
+};
+
+extern const KindCodes kind_codes;
+
+inline uint8_t compact_kind(Token::Kind kind)
+{
+	if (kind < 0)
+		return (kind == Token::END) ? 0 : 1;
+	return kind_codes.codes[kind];
+}
+
+inline Token::Kind expand_kind(uint8_t code)
+{
+	return kind_codes.kinds[code];
+}
+
+// A whole buffer's tokens, stored a field to an array: a byte for the kind
+// and 32 bits each for the offset, length and symbol. That's 13 bytes a
+// token rather than sizeof(Token), and a pass over the kinds alone only
+// touches a byte each. Numbers keep their values in a table of their own,
+// the 32 bits being an index into it.
+class TokenList
+{
+public:
+	size_t size() const { return kinds.size(); }
+	bool empty() const { return kinds.empty(); }
+	void clear();
+	void reserve(size_t n);
+	void push_back(const Token& tok);
+
+	Token operator[](size_t i) const
+	{
+		Token tok;
+		tok.kind = kind(i);
+		tok.location = location(i);
+		if (is_number(tok.kind))
+			tok.set_number(numbers[values[i]]);
+		else
+			tok.symbol = values[i];
+		return tok;
+	}
+	Token::Kind kind(size_t i) const { return expand_kind(kinds[i]); }
+	SourceLocation location(size_t i) const
+	{
+		SourceLocation loc;
+		loc.offset = offsets[i];
+		loc.length = lengths[i];
+		return loc;
+	}
+	size_t start(size_t i) const { return offsets[i]; }
+	// The index of the first token starting at or after offset
+	size_t find(size_t offset) const;
+
+	// Replace count tokens from first with other's from from to to
+	void replace(size_t first, size_t count, const TokenList& other,
+	             size_t from, size_t to);
+	void append(const TokenList& other, size_t from=0)
+	{
+		replace(size(), 0, other, from, other.size());
+	}
+	// Move the tokens from first on along by delta bytes (modulo 2^32, so
+	// a negative delta works)
+	void shift(size_t first, uint32_t delta);
+
+private:
+	std::vector<uint8_t> kinds;
+	std::vector<uint32_t> offsets, lengths, values;
+	std::vector<NumberValue> numbers;
+	size_t dead_numbers = 0; // in numbers, of tokens since replaced
+
+	void compact_numbers();
+};
+
+} // namespace Soda
+
+#endif // SODA_TOKENLIST_H
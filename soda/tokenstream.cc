@@ -0,0 +1,91 @@
+#include <soda/sodainc.h> // pch
+#include <soda/tokenstream.h>
+#include <algorithm>
+#include <cassert>
+
+namespace Soda
+{
+
+static const size_t INITIAL_RING_SIZE = 16;
+
+TokenStream::TokenStream(Lexer& lexer)
+	: lexer(lexer), ring(INITIAL_RING_SIZE), mask(INITIAL_RING_SIZE - 1),
+	  head(0), tail(0), pos(0), at_end(false)
+{
+}
+
+// Lex up to position want, or the END token if it's past the end
+const Token& TokenStream::lex_ahead(size_t want)
+{
+	while (want >= tail && !at_end)
+		fill();
+	if (want >= tail)
+		want = tail - 1;
+	return ring[want & mask];
+}
+
+void TokenStream::next()
+{
+	if (current().kind != Token::END)
+		pos++;
+}
+
+size_t TokenStream::mark()
+{
+	marks.push_back(pos);
+	return pos;
+}
+
+void TokenStream::reset(size_t mark)
+{
+	assert(mark >= head && mark <= pos);
+	pos = mark;
+}
+
+void TokenStream::release(size_t mark)
+{
+	auto it = std::find(marks.rbegin(), marks.rend(), mark);
+	assert(it != marks.rend());
+	marks.erase(std::next(it).base());
+}
+
+void TokenStream::restart()
+{
+	head = tail = pos = 0;
+	marks.clear();
+	at_end = false;
+}
+
+// Lex one more token into the ring, first dropping the tokens before the
+// current position and every mark, or doubling the ring if they're all
+// still needed
+void TokenStream::fill()
+{
+	// nothing before the current position or a mark is looked at again,
+	// its text included
+	size_t keep = pos;
+	for (size_t m : marks)
+		keep = std::min(keep, m);
+	lexer.discard(keep < tail ? ring[keep & mask].location.start()
+	                          : lexer.offset());
+
+	if (tail - head == ring.size())
+	{
+		head = keep;
+		if (tail - head == ring.size())
+		{
+			std::vector<Token> bigger(ring.size() * 2);
+			size_t bigger_mask = bigger.size() - 1;
+			for (size_t i = head; i < tail; i++)
+				bigger[i & bigger_mask] = ring[i & mask];
+			ring.swap(bigger);
+			mask = bigger_mask;
+		}
+	}
+	lexer.next();
+	ring[tail & mask] = lexer.token;
+	tail++;
+	at_end = (lexer.token.kind == Token::END);
+}
+
+} // namespace Soda
@@ -0,0 +1,65 @@
+#ifndef SODA_TOKENSTREAM_H
+#define SODA_TOKENSTREAM_H
+
+#include <soda/lexer.h>
+#include <soda/token.h>
+#include <cstddef>
+#include <vector>
+
+namespace Soda
+{
+
+// Tokens pulled from a Lexer as they're asked for. Only a window around
+// the current position is buffered, in a ring: the lookahead in use plus
+// whatever follows a mark that may be backed up to. Memory use depends on
+// how far the grammar looks ahead, not on the size of the input.
+class TokenStream
+{
+public:
+	explicit TokenStream(Lexer& lexer);
+
+	const Token& current() { return peek(0); }
+	// The token n after the current one, END past the end of the input
+	const Token& peek(size_t n)
+	{
+		if (pos + n < tail)
+			return ring[(pos + n) & mask];
+		return lex_ahead(pos + n);
+	}
+	// Move on to the next token, END is never moved past
+	void next();
+	size_t position() const { return pos; }
+
+	// Remember the current position so reset() can back up to it. The
+	// tokens from there on are kept until the mark is released.
+	size_t mark();
+	void reset(size_t mark);
+	void release(size_t mark);
+
+	// Start again from the lexer's next token, for a lexer that has been
+	// reset. The ring keeps its size.
+	void restart();
+
+	// Number of tokens held in the ring
+	size_t buffered() const { return tail - head; }
+
+private:
+	Lexer& lexer;
+	std::vector<Token> ring; // the size is a power of two
+	size_t mask;             // ring.size() - 1
+	size_t head, tail;       // positions of the oldest token held and one
+	                         // past the newest
+	size_t pos;
+	std::vector<size_t> marks;
+	bool at_end;
+
+	const Token& lex_ahead(size_t want);
+	void fill();
+
+	TokenStream(const TokenStream&);
+	TokenStream& operator=(const TokenStream&);
+};
+
+} // namespace Soda
+
+#endif // SODA_TOKENSTREAM_H
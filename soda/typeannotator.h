@@ -30,29 +30,35 @@ struct TypeAnnotator : public AstVisitor
 	TypeAnnotator(TU& root) : root(root) {}
 
 	std::stack<SymbolTable> scope_stack;
-	std::vector<std::u32string> name_stack;
+	std::vector<Symbol> name_stack;
 	SymbolTable symtab;
 
+	const std::u32string& text(Symbol name)
+	{
+		return root.interner.text(name);
+	}
+
 	std::u32string prefix()
 	{
 		std::u32string pfx;
 		for (auto it = name_stack.begin(); it != name_stack.end(); ++it)
-			{ pfx += *it; pfx += U"."; }
+			{ pfx += text(*it); pfx += U"."; }
 		if (pfx.size() > 0 && pfx[pfx.size()-1] == '.')
 			pfx = pfx.substr(0, pfx.size() - 1);
 		return pfx;
 	}
 
-	std::u32string fq_name(const std::u32string& name)
+	Symbol fq_name(Symbol name)
 	{
 		std::u32string f(prefix());
-		if (f.size() > 0)
-			f += U'.';
-		f += name;
-		return f;
+		if (f.empty())
+			return name;
+		f += U'.';
+		f += text(name);
+		return root.interner.intern(f);
 	}
 
-	void define(const std::u32string& name, Stmt& stmt)
+	void define(Symbol name, Stmt& stmt)
 	{
 		SymbolTable& symbols = scope_stack.top();
 		auto found = symbols.find(name);
@@ -60,22 +66,25 @@ struct TypeAnnotator : public AstVisitor
 			symbols[name] = &stmt;
 		else
 		{
+			SourcePosition prev =
+				root.sources.position(found->second->location.start());
 			std::stringstream ss;
-			ss << "multiple definitions of symbol `" << name
+			ss << "multiple definitions of symbol `" << text(name)
 			   << "' previous declaration was on line "
-			   << found->second->location.line.start + 1
+			   << prev.line + 1
 			   << " at column "
-			   << found->second->location.column.start;
-			throw ParseError("parse error", root.fn, stmt.location, ss.str());
+			   << prev.column + 1;
+			throw ParseError("parse error", root.sources, stmt.location,
+				ss.str());
 		}
 	}
 
-	void begin_scope(std::u32string name=std::u32string())
+	void begin_scope(Symbol name=NO_SYMBOL)
 	{
-		if (!name.empty())
+		if (name != NO_SYMBOL)
 		{
-			std::cerr << "+" << name << std::endl;
-			name_stack.push_back(std::move(name));
+			std::cerr << "+" << text(name) << std::endl;
+			name_stack.push_back(name);
 		}
 		scope_stack.push(SymbolTable());
 	}
@@ -84,7 +93,7 @@ struct TypeAnnotator : public AstVisitor
 	{
 		if (!name_stack.empty())
 		{
-			std::cerr << "-" << name_stack.back() << std::endl;
+			std::cerr << "-" << text(name_stack.back()) << std::endl;
 			name_stack.pop_back();
 		}
 		symbols.swap(scope_stack.top());
@@ -140,7 +149,7 @@ struct TypeAnnotator : public AstVisitor
 
 	bool visit(FuncDef& node)
 	{
-		std::u32string tmp(fq_name(node.name->name));
+		Symbol tmp = fq_name(node.name->name);
 		define(node.name->name, node);
 		begin_scope(node.name->name);
 		node.name->name = tmp;
@@ -166,7 +175,7 @@ struct TypeAnnotator : public AstVisitor
 		{
 			begin_scope(node.name->name);
 			//node.name->name = fq_name(node.name->name);
-			node.name->name = prefix();
+			node.name->name = root.interner.intern(prefix());
 		}
 		else
 			begin_scope();
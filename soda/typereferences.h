@@ -27,7 +27,7 @@ struct TypeReferences : public AstVisitor
 		scope_stack.pop_back();
 	}
 
-	Stmt* find_decl_in_scope(SymbolTable& symtab, const std::u32string& name)
+	Stmt* find_decl_in_scope(SymbolTable& symtab, Symbol name)
 	{
 		auto found = symtab.find(name);
 		if (found == symtab.end())
@@ -35,7 +35,7 @@ struct TypeReferences : public AstVisitor
 		return found->second;
 	}
 
-	Stmt* find_decl(const std::u32string& name)
+	Stmt* find_decl(Symbol name)
 	{
 		if (scope_stack.empty())
 			return nullptr;
@@ -62,8 +62,9 @@ struct TypeReferences : public AstVisitor
 		if (!decl)
 		{
 			std::stringstream ss;
-			ss << "unknown type name `" << node.alias->name << "'";
-			throw ParseError("parse error", root.fn, node.alias->location, ss.str());
+			ss << "unknown type name `" << root.interner.text(node.alias->name) << "'";
+			throw ParseError("parse error", root.sources,
+				node.alias->location, ss.str());
 		}
 		else
 			node.alias->decl = decl;
@@ -76,8 +77,9 @@ struct TypeReferences : public AstVisitor
 		if (!decl)
 		{
 			std::stringstream ss;
-			ss << "unknown type name `" << node.type->name << "'";
-			throw ParseError("parse error", root.fn, node.type->location, ss.str());
+			ss << "unknown type name `" << root.interner.text(node.type->name) << "'";
+			throw ParseError("parse error", root.sources,
+				node.type->location, ss.str());
 		}
 		else
 			node.type->decl = decl;
@@ -95,8 +97,9 @@ struct TypeReferences : public AstVisitor
 				if (!decl)
 				{
 					std::stringstream ss;
-					ss << "unknown type name `" << ident->name << "'";
-					throw ParseError("parse error", root.fn, base_expr->location, ss.str());
+					ss << "unknown type name `" << root.interner.text(ident->name) << "'";
+					throw ParseError("parse error", root.sources,
+						base_expr->location, ss.str());
 				}
 				else
 					ident->decl = decl;
@@ -153,8 +156,9 @@ struct TypeReferences : public AstVisitor
 		if (!decl)
 		{
 			std::stringstream ss;
-			ss << "unknown type name `" << node.type->name << "'";
-			throw ParseError("parse error", root.fn, node.type->location, ss.str());
+			ss << "unknown type name `" << root.interner.text(node.type->name) << "'";
+			throw ParseError("parse error", root.sources,
+				node.type->location, ss.str());
 		}
 		else
 			node.type->decl = decl;
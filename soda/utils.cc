@@ -1,106 +1,54 @@
 #include <soda/sodainc.h>
 #include <soda/utils.h>
+#include <soda/encoding.h>
 #include <vector>
 #include <utf8/utf8.h>
 
-// TODO: these functions should probably be inline
-
 namespace Soda
 {
 
-bool is_newline(char32_t ch)
-{ // http://www.unicode.org/standard/reports/tr13/tr13-5.html
-	switch (ch)
-	{
-		case 0x000A: // Line Feed
-		case 0x000B: // Vertical Tab
-		case 0x000C: // Form Feed
-		case 0x000D: // Carriage Return
-		case 0x0085: // Next Line
-		case 0x2028: // Line Separator
-		case 0x2029: // Paragraph Separator
-			return true;
-		default:
-			return false; // Not a new line character
-	}
-}
-
-bool is_whitespace(char32_t ch)
-{ // http://en.wikipedia.org/wiki/Whitespace_character#Unicode
-	switch (ch)
-	{
-		case 0x0009: // Horizontal Tab
-		case 0x000A: // Line Feed
-		case 0x000B: // Vertical Tab
-		case 0x000C: // Form Feed
-		case 0x000D: // Carriage Return
-		case 0x0020: // Space
-		case 0x0085: // Next Line
-		case 0x00A0: // No-Break Space
-		case 0x1680: // Ogham Space Mark
-		case 0x2000: // EN Quad
-		case 0x2001: // EM Quad
-		case 0x2002: // EN Space
-		case 0x2003: // EM Space
-		case 0x2004: // Three-Per-EM Space
-		case 0x2005: // Four-Per-EM Space
-		case 0x2006: // Size-Per-EM Space
-		case 0x2007: // Figure Space
-		case 0x2008: // Punctuation Space
-		case 0x2009: // Thin Space
-		case 0x200A: // Hair Space
-		case 0x2028: // Line Separator
-		case 0x2029: // Paragraph Separator
-		case 0x202F: // Narrow No-Break Space
-		case 0x205F: // Medium Mathematical Space
-		case 0x3000: // Ideographic Space
-			return true;
-		default:
-			return false;
-	}
-}
-
-bool is_upper(char32_t ch)
+namespace
 {
-	return (ch >= 'A' && ch <= 'Z');
-}
 
-bool is_lower(char32_t ch)
+constexpr bool in_range(unsigned c, unsigned lo, unsigned hi)
 {
-	return (ch >= 'a' && ch <= 'z');
+	return c >= lo && c <= hi;
 }
 
-bool is_alpha(char32_t ch)
+constexpr uint16_t classify(unsigned c)
 {
-	return (is_lower(ch) || is_upper(ch));
+	return
+		((c >= 0x0A && c <= 0x0D) || c == 0x85 ? CC_NEWLINE : 0) |
+		(c == 0x09 || in_range(c, 0x0A, 0x0D) || c == 0x20 || c == 0x85 ||
+		 c == 0xA0 ? CC_SPACE : 0) |
+		(in_range(c, 'A', 'Z') ? CC_UPPER | CC_IDENT_START | CC_IDENT : 0) |
+		(in_range(c, 'a', 'z') ? CC_LOWER | CC_IDENT_START | CC_IDENT : 0) |
+		(c == '_' ? CC_IDENT_START | CC_IDENT : 0) |
+		(in_range(c, '0', '9') ? CC_DIGIT | CC_HEX | CC_IDENT : 0) |
+		(in_range(c, 'A', 'F') || in_range(c, 'a', 'f') ? CC_HEX : 0) |
+		(in_range(c, '0', '1') ? CC_BINARY : 0) |
+		(in_range(c, '0', '7') ? CC_OCTAL : 0);
 }
 
-bool is_digit(char32_t ch)
-{
-	return (ch >= '0' && ch <= '9');
-}
+} // anonymous namespace
 
-bool is_alnum(char32_t ch)
-{
-	return (is_alpha(ch) || is_digit(ch));
-}
+#define C4(c) classify(c), classify(c + 1), classify(c + 2), classify(c + 3)
+#define C16(c) C4(c), C4(c + 4), C4(c + 8), C4(c + 12)
+#define C64(c) C16(c), C16(c + 16), C16(c + 32), C16(c + 48)
 
-bool is_hex(char32_t ch)
-{
-	return (ch >= '0' && ch <= '9') ||
-	       (ch >= 'A' && ch <= 'F') ||
-	       (ch >= 'a' && ch <= 'f');
-}
+constexpr uint16_t char_classes[256] = {
+	C64(0), C64(64), C64(128), C64(192)
+};
 
-bool is_binary(char32_t ch)
-{
-	return (ch == '0' || ch == '1');
-}
+#undef C64
+#undef C16
+#undef C4
 
-bool is_octal(char32_t ch)
-{
-	return (ch >= '0' && ch <= '7');
-}
+static_assert(char_classes[' '] == CC_SPACE, "space");
+static_assert(char_classes['f'] == (CC_LOWER | CC_HEX | CC_IDENT_START |
+                                    CC_IDENT), "hex letter");
+static_assert(char_classes['7'] == (CC_DIGIT | CC_HEX | CC_OCTAL | CC_IDENT),
+              "octal digit");
 
 // FIXME: make this good
 std::string utf8_encode(const std::u32string& u32str)
@@ -116,4 +64,27 @@ std::string utf8_encode(const std::u32string& u32str)
 	return str;
 }
 
+std::u32string utf8_decode(const char *begin, const char *end)
+{
+	std::u32string str;
+	str.reserve(end - begin);
+	utf8_decode(begin, end, str);
+	return str;
+}
+
+void utf8_decode(const char *begin, const char *end, std::u32string& out)
+{
+	const char *p = begin;
+	while (p < end)
+	{
+		char32_t cp;
+		decode_utf8(p, end, cp);
+		if (cp == U'\uFEFF' || cp == U'\u2060')
+			continue;
+		if (cp == '\r' && p < end && *p == '\n')
+			continue;
+		out += cp;
+	}
+}
+
 } // namespace Soda
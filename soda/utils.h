@@ -1,24 +1,83 @@
 #ifndef SODA_UTILS_H
 #define SODA_UTILS_H
 
-#include <uchar.h>
+#include <soda/xid.h>
+#include <cstdint>
 #include <string>
+#include <uchar.h>
 
 namespace Soda
 {
 
-bool is_newline(char32_t ch);
-bool is_whitespace(char32_t ch);
-bool is_upper(char32_t ch);
-bool is_lower(char32_t ch);
-bool is_alpha(char32_t ch);
-bool is_digit(char32_t ch);
-bool is_alnum(char32_t ch);
-bool is_hex(char32_t ch);
-bool is_binary(char32_t ch);
-bool is_octal(char32_t ch);
+// Classes of the first 256 code points, a bit each, looked up in
+// char_classes
+enum CharClass
+{
+	CC_NEWLINE     = 1 << 0,
+	CC_SPACE       = 1 << 1,
+	CC_UPPER       = 1 << 2,
+	CC_LOWER       = 1 << 3,
+	CC_DIGIT       = 1 << 4,
+	CC_HEX         = 1 << 5,
+	CC_BINARY      = 1 << 6,
+	CC_OCTAL       = 1 << 7,
+	CC_IDENT_START = 1 << 8, // ASCII letters and '_'
+	CC_IDENT       = 1 << 9, // and digits
+};
+
+extern const uint16_t char_classes[256];
+
+inline bool in_class(char32_t ch, unsigned cls)
+{
+	return ch < 256 && (char_classes[ch] & cls) != 0;
+}
+
+// http://www.unicode.org/standard/reports/tr13/tr13-5.html
+inline bool is_newline(char32_t ch)
+{
+	return (ch < 256) ? in_class(ch, CC_NEWLINE) :
+	       (ch == 0x2028 || ch == 0x2029);
+}
+
+// http://en.wikipedia.org/wiki/Whitespace_character#Unicode
+inline bool is_whitespace(char32_t ch)
+{
+	return (ch < 256) ? in_class(ch, CC_SPACE) :
+	       (ch == 0x1680 || (ch >= 0x2000 && ch <= 0x200A) ||
+	        ch == 0x2028 || ch == 0x2029 || ch == 0x202F || ch == 0x205F ||
+	        ch == 0x3000);
+}
+
+inline bool is_upper(char32_t ch) { return in_class(ch, CC_UPPER); }
+inline bool is_lower(char32_t ch) { return in_class(ch, CC_LOWER); }
+inline bool is_alpha(char32_t ch) { return in_class(ch, CC_UPPER | CC_LOWER); }
+inline bool is_digit(char32_t ch) { return in_class(ch, CC_DIGIT); }
+inline bool is_alnum(char32_t ch)
+{
+	return in_class(ch, CC_UPPER | CC_LOWER | CC_DIGIT);
+}
+inline bool is_hex(char32_t ch) { return in_class(ch, CC_HEX); }
+inline bool is_binary(char32_t ch) { return in_class(ch, CC_BINARY); }
+inline bool is_octal(char32_t ch) { return in_class(ch, CC_OCTAL); }
+
+// Identifiers are Unicode's XID_Start XID_Continue*, with '_' allowed to
+// start one too
+inline bool is_ident_start(char32_t ch)
+{
+	return (ch < 0x80) ? in_class(ch, CC_IDENT_START) : is_xid_start(ch);
+}
+
+inline bool is_ident_continue(char32_t ch)
+{
+	return (ch < 0x80) ? in_class(ch, CC_IDENT) : is_xid_continue(ch);
+}
 
 std::string utf8_encode(const std::u32string& u32str);
+// Decode UTF-8 source text the way Input reads it: BOMs and word joiners
+// are dropped, CR LF becomes LF and malformed sequences become U+FFFD
+std::u32string utf8_decode(const char *begin, const char *end);
+// The same, appended to out
+void utf8_decode(const char *begin, const char *end, std::u32string& out);
 
 } // namespace Soda
 
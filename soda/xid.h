@@ -0,0 +1,42 @@
+#ifndef SODA_XID_H
+#define SODA_XID_H
+
+#include <cstdint>
+#include <uchar.h>
+
+namespace Soda
+{
+
+// The Unicode XID_Start and XID_Continue properties, in a two-level table
+// generated by scripts/genxid.py: xid_index maps each block of XID_BLOCK
+// code points to one of the distinct blocks in xid_bits, which hold a bit
+// per code point for each property. Code points past the last block have
+// neither.
+const unsigned XID_BLOCK = 256;
+const unsigned XID_BLOCKS = 3586;
+
+extern const uint8_t xid_index[XID_BLOCKS];
+extern const uint32_t xid_bits[][2][XID_BLOCK / 32];
+
+inline bool xid_property(char32_t ch, int which)
+{
+	if (ch / XID_BLOCK >= XID_BLOCKS)
+		return false;
+	const uint32_t *bits = xid_bits[xid_index[ch / XID_BLOCK]][which];
+	unsigned bit = ch % XID_BLOCK;
+	return (bits[bit / 32] >> (bit % 32)) & 1;
+}
+
+inline bool is_xid_start(char32_t ch)
+{
+	return xid_property(ch, 0);
+}
+
+inline bool is_xid_continue(char32_t ch)
+{
+	return xid_property(ch, 1);
+}
+
+} // namespace Soda
+
+#endif // SODA_XID_H